@@ -9,6 +9,8 @@ SCAN_DIR ?= package
 TARGET_STAMP:=$(TMP_DIR)/info/.files-$(SCAN_TARGET).stamp
 FILELIST:=$(TMP_DIR)/info/.files-$(SCAN_TARGET)-$(SCAN_COOKIE)
 OVERRIDELIST:=$(TMP_DIR)/info/.overrides-$(SCAN_TARGET)-$(SCAN_COOKIE)
+CACHE_DIR:=$(TMP_DIR)/info/.cache-$(SCAN_TARGET)
+CACHE_KEEP:=4
 
 export PATH:=$(TOPDIR)/staging_dir/host/bin:$(PATH)
 
@@ -26,21 +28,47 @@ define feedname
 $(if $(patsubst feeds/%,,$(1)),,$(word 2,$(subst /, ,$(1))))
 endef
 
+# Dumps are cached under the hash of everything that can be included while
+# running them: the generic makefiles, SCAN_DEPS, all makefiles found in the
+# package directory and those it includes from elsewhere (e.g. other feed
+# directories, see scripts/scan-includes.sh). Touching files or switching branches back and forth
+# then does not require running the dump again. Only the newest CACHE_KEEP
+# dumps of a package are kept.
+SCAN_GLOBAL_HASH:=$(shell cat $(TOPDIR)/rules.mk $(TOPDIR)/include/*.mk | $(TOPDIR)/staging_dir/host/bin/mkhash md5)
+
 define PackageDir
   $(TMP_DIR)/.$(SCAN_TARGET): $(TMP_DIR)/info/.$(SCAN_TARGET)-$(1)
   $(TMP_DIR)/info/.$(SCAN_TARGET)-$(1): $(SCAN_DIR)/$(2)/Makefile $(foreach DEP,$(DEPS_$(SCAN_DIR)/$(2)/Makefile) $(SCAN_DEPS),$(wildcard $(if $(filter /%,$(DEP)),$(DEP),$(SCAN_DIR)/$(2)/$(DEP))))
-	{ \
-		$$(call progress,Collecting $(SCAN_NAME) info: $(SCAN_DIR)/$(2)) \
-		echo Source-Makefile: $(SCAN_DIR)/$(2)/Makefile; \
-		$(if $(3),echo Override: $(3),true); \
-		$(NO_TRACE_MAKE) --no-print-dir -r DUMP=1 FEED="$(call feedname,$(2))" -C $(SCAN_DIR)/$(2) $(SCAN_MAKEOPTS) 2>/dev/null || { \
-			mkdir -p "$(TOPDIR)/logs/$(SCAN_DIR)/$(2)"; \
-			$(NO_TRACE_MAKE) --no-print-dir -r DUMP=1 FEED="$(call feedname,$(2))" -C $(SCAN_DIR)/$(2) $(SCAN_MAKEOPTS) > $(TOPDIR)/logs/$(SCAN_DIR)/$(2)/dump.txt 2>&1; \
-			$$(call progress,ERROR: please fix $(SCAN_DIR)/$(2)/Makefile - see logs/$(SCAN_DIR)/$(2)/dump.txt for details\n) \
-			rm -f $$@; \
+	mkdir -p $(CACHE_DIR)/$(1)
+	HASH=$$$$( { \
+		echo "$(2) $(3) $(SCAN_MAKEOPTS) $(SCAN_GLOBAL_HASH)"; \
+		cat $$^; \
+		find $(SCAN_DIR)/$(2) -maxdepth 3 \( -name Makefile -o -name '*.mk' \) | sort | xargs cat; \
+		$(TOPDIR)/scripts/scan-includes.sh $(TOPDIR) $(SCAN_DIR)/$(2) | xargs cat; \
+	} | mkhash md5 ); \
+	CACHE="$(CACHE_DIR)/$(1)/$$$$HASH"; \
+	if [ -f "$$$$CACHE" ]; then \
+		cp "$$$$CACHE" $$@.tmp; \
+	else \
+		FAILED=; \
+		{ \
+			$$(call progress,Collecting $(SCAN_NAME) info: $(SCAN_DIR)/$(2)) \
+			echo Source-Makefile: $(SCAN_DIR)/$(2)/Makefile; \
+			$(if $(3),echo Override: $(3),true); \
+			$(NO_TRACE_MAKE) --no-print-dir -r DUMP=1 FEED="$(call feedname,$(2))" -C $(SCAN_DIR)/$(2) $(SCAN_MAKEOPTS) 2>/dev/null || { \
+				mkdir -p "$(TOPDIR)/logs/$(SCAN_DIR)/$(2)"; \
+				$(NO_TRACE_MAKE) --no-print-dir -r DUMP=1 FEED="$(call feedname,$(2))" -C $(SCAN_DIR)/$(2) $(SCAN_MAKEOPTS) > $(TOPDIR)/logs/$(SCAN_DIR)/$(2)/dump.txt 2>&1; \
+				$$(call progress,ERROR: please fix $(SCAN_DIR)/$(2)/Makefile - see logs/$(SCAN_DIR)/$(2)/dump.txt for details\n) \
+				rm -f $$@; \
+				FAILED=1; \
+			}; \
+			echo; \
+		} > $$@.tmp; \
+		[ -n "$$$$FAILED" ] || { \
+			cp $$@.tmp "$$$$CACHE"; \
+			ls -t $(CACHE_DIR)/$(1)/* | tail -n +$$$$(($(CACHE_KEEP) + 1)) | xargs rm -f; \
 		}; \
-		echo; \
-	} > $$@.tmp
+	fi
 	mv $$@.tmp $$@
 endef
 
@@ -96,9 +124,16 @@ $(TARGET_STAMP)::
 $(TMP_DIR)/.$(SCAN_TARGET): $(TARGET_STAMP)
 	$(call progress,Collecting $(SCAN_NAME) info: merging...)
 	-cat $(FILELIST) | awk '{gsub(/\//, "_", $$0);print "$(TMP_DIR)/info/.$(SCAN_TARGET)-" $$0}' | xargs cat > $@ 2>/dev/null
+	-[ ! -d $(CACHE_DIR) ] || ls $(CACHE_DIR) | awk -v fl=$(FILELIST) ' \
+		BEGIN { \
+			while (getline < fl) { \
+				gsub(/\//, "_", $$0); \
+				keep[$$0]=1 \
+			} \
+		} \
+		!($$0 in keep) { print "$(CACHE_DIR)/" $$0 } ' | xargs rm -rf
 	$(call progress,Collecting $(SCAN_NAME) info: done)
 	echo
 
 FORCE:
 .PHONY: FORCE
-.NOTPARALLEL:
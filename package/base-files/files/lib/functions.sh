@@ -17,6 +17,35 @@ NO_EXPORT=1
 LOAD_STATE=1
 LIST_SEP=" "
 
+# boot tracing is active while this file exists, see boottrace_event
+BOOTTRACE=/tmp/boottrace.log
+
+# uptime in milliseconds
+boottrace_now() {
+	local up idle
+	read up idle < /proc/uptime
+	eval "$1=$((${up%.*} * 1000 + (1${up#*.} - 100) * 10))"
+}
+
+# boottrace_event <category> <name> <start>
+# append one event, which started at <start> (from boottrace_now), as a
+# JSON line to the trace; scripts/boottrace.py renders it as a timeline
+boottrace_event() {
+	local end cat="$1" name="$2"
+
+	# quotes and backslashes have to be escaped in JSON strings
+	case "$cat$name" in
+		*[\"\\]*)
+			cat="$(printf '%s' "$cat" | sed 's/["\\]/\\&/g')"
+			name="$(printf '%s' "$name" | sed 's/["\\]/\\&/g')"
+		;;
+	esac
+
+	boottrace_now end
+	printf '{"cat":"%s","name":"%s","ts":%d,"dur":%d,"pid":%d}\n' \
+		"$cat" "$name" "$3" "$((end - $3))" "$$" >> "$BOOTTRACE"
+}
+
 append() {
 	local var="$1"
 	local value="$2"
@@ -59,7 +59,10 @@ boot_run_hook() {
 		local ran; eval "ran=\$PI_RAN_$func"
 		[ -n "$ran" ] || {
 			export -n "PI_RAN_$func=1"
+			local start=
+			[ -f "$BOOTTRACE" ] && boottrace_now start
 			$func "$1" "$2"
+			[ -n "$start" ] && boottrace_event preinit "$hook/$func" "$start"
 		}
 	done
 }
@@ -40,12 +40,20 @@
  *	i2c-gpio-custom.bus1
  *	i2c-gpio-custom.bus2
  *	i2c-gpio-custom.bus3
+ *
+ *  When the calibrate parameter is set, the cost of driving the SCL pin is
+ *  measured before the bus is registered. Together with the udelay value
+ *  it gives the bus clock which is really reached by bit-banging. The
+ *  results are shown in the gpio_op_ns, clock_hz and throughput (bytes/s)
+ *  attributes of the i2c-gpio platform device.
  */
 
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/platform_device.h>
+#include <linux/ktime.h>
+#include <linux/gpio.h>
 
 #include <linux/i2c-gpio.h>
 
@@ -68,6 +76,10 @@
 #define BUS_PARAM_COUNT		8
 #define BUS_COUNT_MAX		4
 
+#define CALIB_LOOPS		1000
+/* GPIO accesses per bit: SDA write, SCL high, SCL read, SCL low */
+#define CALIB_OPS_PER_BIT	4
+
 static unsigned int bus0[BUS_PARAM_COUNT] __initdata;
 static unsigned int bus1[BUS_PARAM_COUNT] __initdata;
 static unsigned int bus2[BUS_PARAM_COUNT] __initdata;
@@ -87,9 +99,139 @@ MODULE_PARM_DESC(bus2, "bus2" BUS_PARM_DESC);
 module_param_array(bus3, uint, &bus_nump[3], 0);
 MODULE_PARM_DESC(bus3, "bus3" BUS_PARM_DESC);
 
+static bool calibrate;
+module_param(calibrate, bool, 0);
+MODULE_PARM_DESC(calibrate, "measure the achievable clock at probe time");
+
 static struct platform_device *devices[BUS_COUNT_MAX];
 static unsigned int nr_devices;
 
+static struct {
+	int id;
+	unsigned int op_ns;
+	unsigned int clock_hz;
+} calib[BUS_COUNT_MAX];
+
+/* the attributes exist as soon as the device is added, look up by bus id */
+static int i2c_gpio_custom_index(struct device *dev)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(calib); i++)
+		if (calib[i].clock_hz && calib[i].id == to_platform_device(dev)->id)
+			return i;
+
+	return -ENODEV;
+}
+
+static ssize_t gpio_op_ns_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	int i = i2c_gpio_custom_index(dev);
+
+	if (i < 0)
+		return i;
+
+	return sprintf(buf, "%u\n", calib[i].op_ns);
+}
+static DEVICE_ATTR_RO(gpio_op_ns);
+
+static ssize_t clock_hz_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	int i = i2c_gpio_custom_index(dev);
+
+	if (i < 0)
+		return i;
+
+	return sprintf(buf, "%u\n", calib[i].clock_hz);
+}
+static DEVICE_ATTR_RO(clock_hz);
+
+/* nine clocks per byte, including the acknowledge bit */
+static ssize_t throughput_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	int i = i2c_gpio_custom_index(dev);
+
+	if (i < 0)
+		return i;
+
+	return sprintf(buf, "%u\n", calib[i].clock_hz / 9);
+}
+static DEVICE_ATTR_RO(throughput);
+
+static struct attribute *i2c_gpio_custom_attrs[] = {
+	&dev_attr_gpio_op_ns.attr,
+	&dev_attr_clock_hz.attr,
+	&dev_attr_throughput.attr,
+	NULL,
+};
+
+static const struct attribute_group i2c_gpio_custom_group = {
+	.attrs = i2c_gpio_custom_attrs,
+};
+
+static const struct attribute_group *i2c_gpio_custom_groups[] = {
+	&i2c_gpio_custom_group,
+	NULL,
+};
+
+/*
+ * Measure the cost of releasing the SCL pin the way i2c-gpio does it. The
+ * line is idle high, so repeatedly releasing it produces no edge.
+ */
+static unsigned int __init
+i2c_gpio_custom_calibrate(struct i2c_gpio_platform_data *pdata)
+{
+	unsigned int pin = pdata->scl_pin;
+	ktime_t start;
+	u64 ns;
+	int i;
+
+	if (gpio_request_one(pin, pdata->scl_is_open_drain ?
+			     GPIOF_OUT_INIT_HIGH : GPIOF_IN, DRV_NAME))
+		return 0;
+
+	start = ktime_get();
+	for (i = 0; i < CALIB_LOOPS; i++) {
+		if (pdata->scl_is_open_drain)
+			gpio_set_value(pin, 1);
+		else
+			gpio_direction_input(pin);
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	gpio_free(pin);
+
+	return max_t(u64, div_u64(ns, CALIB_LOOPS), 1);
+}
+
+static void __init i2c_gpio_custom_calib_one(unsigned int id,
+		struct i2c_gpio_platform_data *pdata)
+{
+	unsigned int udelay;
+
+	memset(&calib[nr_devices], 0, sizeof(calib[nr_devices]));
+	calib[nr_devices].id = id;
+	if (!calibrate)
+		return;
+
+	/* same default as i2c-gpio */
+	udelay = pdata->udelay;
+	if (!udelay)
+		udelay = pdata->scl_is_output_only ? 50 : 5;
+
+	calib[nr_devices].op_ns = i2c_gpio_custom_calibrate(pdata);
+	if (calib[nr_devices].op_ns)
+		calib[nr_devices].clock_hz = NSEC_PER_SEC /
+			(2 * udelay * NSEC_PER_USEC +
+			 CALIB_OPS_PER_BIT * calib[nr_devices].op_ns);
+
+	printk(KERN_INFO PFX "bus %d: %u ns per GPIO access, %u Hz\n",
+	       id, calib[nr_devices].op_ns, calib[nr_devices].clock_hz);
+}
+
 static void i2c_gpio_custom_cleanup(void)
 {
 	int i;
@@ -128,10 +270,15 @@ static int __init i2c_gpio_custom_add_one(unsigned int id, unsigned int *params)
 	pdata.scl_is_open_drain = params[BUS_PARAM_SCL_OD] != 0;
 	pdata.scl_is_output_only = params[BUS_PARAM_SCL_OO] != 0;
 
+	i2c_gpio_custom_calib_one(params[BUS_PARAM_ID], &pdata);
+
 	err = platform_device_add_data(pdev, &pdata, sizeof(pdata));
 	if (err)
 		goto err_put;
 
+	if (calib[nr_devices].clock_hz)
+		pdev->dev.groups = i2c_gpio_custom_groups;
+
 	err = platform_device_add(pdev);
 	if (err)
 		goto err_put;
@@ -44,6 +44,7 @@ struct ltq_atm_ops {
 };
 
 #include <linux/atomic.h>
+#include <linux/skbuff.h>
 #include <lantiq_atm.h>
 
 /*
@@ -136,6 +137,8 @@ struct ltq_atm_ops {
 #define RX_DMA_CH_OAM_DESC_LEN          32
 #define RX_DMA_CH_OAM_BUF_SIZE          ((CELL_SIZE + 14) & ~15)
 #define RX_DMA_CH_AAL_BUF_SIZE          (2048 - 48)
+#define RX_SKB_POOL_SIZE                32
+#define RX_SKB_POOL_REFILL              8
 
 /*
  *  OAM Constants
@@ -201,6 +204,11 @@ struct connection {
 	unsigned int aal5_vcc_crc_err; /* number of packets with CRC error */
 	unsigned int aal5_vcc_oversize_sdu; /* number of packets with oversize error */
 
+	unsigned int rx_pdu;        /* packets passed to upper layer */
+	unsigned int rx_bytes;      /* bytes passed to upper layer */
+	unsigned int rx_drop_pdu;   /* packets dropped by driver on RX */
+	unsigned int rx_copybreak;  /* packets copied, DMA buffer kept in ring */
+
 	unsigned int port;
 };
 
@@ -215,6 +223,8 @@ struct atm_priv_data {
 	unsigned char *oam_buf;
 	unsigned int oam_desc_pos;
 
+	struct sk_buff_head rx_skb_pool; /* prepared RX buffers for the AAL ring */
+
 	struct port port[ATM_PORT_NUMBER];
 
 	unsigned int wrx_pdu;        /*  successfully received AAL5 packet       */
@@ -41,6 +41,7 @@
 #include <linux/atm.h>
 #include <linux/clk.h>
 #include <linux/interrupt.h>
+#include <linux/netdevice.h>
 #ifdef CONFIG_XFRM
   #include <net/xfrm.h>
 #endif
@@ -107,6 +108,14 @@ static int dma_tx_descriptor_length = 64;       /*  Number of descriptors per DM
   \brief PPE core clock cycles between descriptor write and effectiveness in external RAM
  */
 static int dma_rx_clp1_descriptor_threshold = 38;
+/*!
+  \brief Max number of AAL5 frames handled per NAPI poll
+ */
+static int napi_weight = NAPI_POLL_WEIGHT;      /*  Max number of AAL5 frames handled per NAPI poll */
+/*!
+  \brief Frames up to this size are copied and the DMA buffer stays in the ring
+ */
+static int rx_copybreak = 128;                  /*  Frames up to this size are copied               */
 /*@}*/
 
 MODULE_PARM(qsb_tau, "i");
@@ -139,6 +148,11 @@ MODULE_PARM_DESC(dma_tx_descriptor_length, "Number of descriptor assigned to DMA
 MODULE_PARM(dma_rx_clp1_descriptor_threshold, "i");
 MODULE_PARM_DESC(dma_rx_clp1_descriptor_threshold, "Descriptor threshold for cells with cell loss priority 1");
 
+MODULE_PARM(napi_weight, "i");
+MODULE_PARM_DESC(napi_weight, "Max number of AAL5 frames handled per NAPI poll");
+MODULE_PARM(rx_copybreak, "i");
+MODULE_PARM_DESC(rx_copybreak, "Copy downstream frames up to this size and keep the DMA buffer");
+
 
 
 /*
@@ -171,6 +185,7 @@ static void ppe_close(struct atm_vcc *);
 static int ppe_send(struct atm_vcc *, struct sk_buff *);
 static int ppe_send_oam(struct atm_vcc *, void *, int);
 static int ppe_change_qos(struct atm_vcc *, struct atm_qos *, int);
+static int ppe_proc_read(struct atm_dev *, loff_t *, char *);
 
 /*
  *  ADSL LED
@@ -185,7 +200,9 @@ static inline void u64_add_u32(ppe_u64_t, unsigned int, ppe_u64_t *);
 /*
  *  buffer manage functions
  */
+static inline struct sk_buff* prepare_skb_rx(struct sk_buff *);
 static inline struct sk_buff* alloc_skb_rx(void);
+static void refill_skb_rx_pool(void);
 static inline struct sk_buff* alloc_skb_tx(unsigned int);
 struct sk_buff* atm_alloc_tx(struct atm_vcc *, unsigned int);
 static inline void atm_free_tx_skb_vcc(struct sk_buff *, struct atm_vcc *);
@@ -196,11 +213,10 @@ static inline int get_tx_desc(unsigned int);
  *  mailbox handler and signal function
  */
 static inline void mailbox_oam_rx_handler(void);
-static inline void mailbox_aal_rx_handler(void);
+static inline int mailbox_aal_rx_handler(int);
 static irqreturn_t mailbox_irq_handler(int, void *);
 static inline void mailbox_signal(unsigned int, int);
-static void do_ppe_tasklet(unsigned long);
-DECLARE_TASKLET(g_dma_tasklet, do_ppe_tasklet, 0);
+static int ppe_napi_poll(struct napi_struct *, int);
 
 /*
  *  QSB & HTU setting functions
@@ -265,6 +281,10 @@ static struct sk_buff* (*ifx_atm_alloc_tx)(struct atm_vcc *, unsigned int) = NUL
 
 static struct atm_priv_data g_atm_priv_data;
 
+/*  the ATM devices have no net_device, NAPI runs on a dummy one   */
+static struct net_device g_atm_napi_dev;
+static struct napi_struct g_atm_napi;
+
 static struct atmdev_ops g_ifx_atm_ops = {
 	.open = ppe_open,
 	.close = ppe_close,
@@ -272,6 +292,7 @@ static struct atmdev_ops g_ifx_atm_ops = {
 	.send = ppe_send,
 	.send_oam = ppe_send_oam,
 	.change_qos = ppe_change_qos,
+	.proc_read = ppe_proc_read,
 	.owner = THIS_MODULE,
 };
 
@@ -354,6 +375,32 @@ static int ppe_ioctl(struct atm_dev *dev, unsigned int cmd, void *arg)
 	return ret;
 }
 
+/*
+ *  per-VCC RX counters, shown in /proc/net/atm/<dev>
+ */
+static int ppe_proc_read(struct atm_dev *dev, loff_t *pos, char *page)
+{
+	loff_t left = *pos;
+	struct connection *p_conn;
+	int i;
+
+	if ( !left-- )
+		return sprintf(page, "%-9s %10s %10s %10s %10s %8s %8s\n", "vpi/vci", "rx_pdu", "rx_bytes", "rx_drop", "rx_copy", "crc_err", "ovz_sdu");
+
+	for ( i = 0; i < MAX_PVC_NUMBER; i++ ) {
+		p_conn = &g_atm_priv_data.conn[i];
+		if ( !test_bit(i, &g_atm_priv_data.conn_table) || p_conn->vcc == NULL || p_conn->vcc->dev != dev )
+			continue;
+		if ( !left-- )
+			return sprintf(page, "%3d/%-5d %10u %10u %10u %10u %8u %8u\n",
+				p_conn->vcc->vpi, p_conn->vcc->vci,
+				p_conn->rx_pdu, p_conn->rx_bytes, p_conn->rx_drop_pdu, p_conn->rx_copybreak,
+				p_conn->aal5_vcc_crc_err, p_conn->aal5_vcc_oversize_sdu);
+	}
+
+	return 0;
+}
+
 static int ppe_open(struct atm_vcc *vcc)
 {
 	int ret;
@@ -477,6 +524,10 @@ static void ppe_close(struct atm_vcc *vcc)
 	connection->vcc = NULL;
 	connection->aal5_vcc_crc_err = 0;
 	connection->aal5_vcc_oversize_sdu = 0;
+	connection->rx_pdu = 0;
+	connection->rx_bytes = 0;
+	connection->rx_drop_pdu = 0;
+	connection->rx_copybreak = 0;
 	clear_bit(conn, &g_atm_priv_data.conn_table);
 
 	/*  disable irq */
@@ -503,7 +554,7 @@ static void ppe_close(struct atm_vcc *vcc)
 	}
 
 	/* wait for incoming packets to be processed by upper layers */
-	tasklet_unlock_wait(&g_dma_tasklet);
+	napi_synchronize(&g_atm_napi);
 
 PPE_CLOSE_EXIT:
 	return;
@@ -748,29 +799,59 @@ static inline void u64_add_u32(ppe_u64_t opt1, unsigned int opt2, ppe_u64_t *ret
 		ret->h++;
 }
 
+static inline struct sk_buff* prepare_skb_rx(struct sk_buff *skb)
+{
+	/*  must be burst length alignment  */
+	if ( ((unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1)) != 0 )
+		skb_reserve(skb, ~((unsigned int)skb->data + (DATA_BUFFER_ALIGNMENT - 1)) & (DATA_BUFFER_ALIGNMENT - 1));
+	/*  pub skb in reserved area "skb->data - 4"    */
+	*((struct sk_buff **)skb->data - 1) = skb;
+	/*  write back and invalidate cache */
+	dma_cache_wback_inv((unsigned long)skb->data - sizeof(skb), sizeof(skb));
+	/*  invalidate cache    */
+#if defined(ENABLE_LESS_CACHE_INV) && ENABLE_LESS_CACHE_INV
+	dma_cache_inv((unsigned long)skb->data, LESS_CACHE_INV_LEN);
+#else
+	dma_cache_inv((unsigned long)skb->data, RX_DMA_CH_AAL_BUF_SIZE);
+#endif
+	return skb;
+}
+
+/*
+ *  RX buffers are taken from a pool of already aligned and invalidated
+ *  skbs, refilled in batches at the end of each NAPI poll. The pool is
+ *  only touched from the poll or while NAPI is disabled, so no locking.
+ */
 static inline struct sk_buff* alloc_skb_rx(void)
 {
 	struct sk_buff *skb;
 
+	skb = __skb_dequeue(&g_atm_priv_data.rx_skb_pool);
+	if ( skb != NULL )
+		return skb;
+
 	skb = dev_alloc_skb(RX_DMA_CH_AAL_BUF_SIZE + DATA_BUFFER_ALIGNMENT);
-	if ( skb != NULL ) {
-		/*  must be burst length alignment  */
-		if ( ((unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1)) != 0 )
-			skb_reserve(skb, ~((unsigned int)skb->data + (DATA_BUFFER_ALIGNMENT - 1)) & (DATA_BUFFER_ALIGNMENT - 1));
-		/*  pub skb in reserved area "skb->data - 4"    */
-		*((struct sk_buff **)skb->data - 1) = skb;
-		/*  write back and invalidate cache */
-		dma_cache_wback_inv((unsigned long)skb->data - sizeof(skb), sizeof(skb));
-		/*  invalidate cache    */
-#if defined(ENABLE_LESS_CACHE_INV) && ENABLE_LESS_CACHE_INV
-		dma_cache_inv((unsigned long)skb->data, LESS_CACHE_INV_LEN);
-#else
-		dma_cache_inv((unsigned long)skb->data, RX_DMA_CH_AAL_BUF_SIZE);
-#endif
-	}
+	if ( skb != NULL )
+		prepare_skb_rx(skb);
 	return skb;
 }
 
+static void refill_skb_rx_pool(void)
+{
+	struct sk_buff_head *pool = &g_atm_priv_data.rx_skb_pool;
+	struct sk_buff *skb;
+
+	if ( skb_queue_len(pool) > RX_SKB_POOL_SIZE - RX_SKB_POOL_REFILL )
+		return;
+
+	while ( skb_queue_len(pool) < RX_SKB_POOL_SIZE ) {
+		skb = dev_alloc_skb(RX_DMA_CH_AAL_BUF_SIZE + DATA_BUFFER_ALIGNMENT);
+		if ( skb == NULL )
+			break;
+		__skb_queue_tail(pool, prepare_skb_rx(skb));
+	}
+}
+
 static inline struct sk_buff* alloc_skb_tx(unsigned int size)
 {
 	struct sk_buff *skb;
@@ -945,16 +1026,47 @@ static inline void mailbox_oam_rx_handler(void)
 	}
 }
 
-static inline void mailbox_aal_rx_handler(void)
+static inline void aal_rx_push(struct connection *p_conn, struct sk_buff *skb)
+{
+	struct atm_vcc *vcc = p_conn->vcc;
+
+	ATM_SKB(skb)->vcc = vcc;
+	p_conn->rx_pdu++;
+	p_conn->rx_bytes += skb->len;
+
+	vcc->push(vcc, skb);
+
+	if ( vcc->qos.aal == ATM_AAL5 )
+		g_atm_priv_data.wrx_pdu++;
+	if ( vcc->stats )
+		atomic_inc(&vcc->stats->rx);
+	adsl_led_flash();
+}
+
+static inline void aal_rx_drop(struct connection *p_conn)
+{
+	struct atm_vcc *vcc = p_conn->vcc;
+
+	p_conn->rx_drop_pdu++;
+	if ( vcc->qos.aal == ATM_AAL5 )
+		g_atm_priv_data.wrx_drop_pdu++;
+	if ( vcc->stats )
+		atomic_inc(&vcc->stats->rx_drop);
+}
+
+static inline int mailbox_aal_rx_handler(int budget)
 {
 	unsigned int vlddes = WRX_DMA_CHANNEL_CONFIG(RX_DMA_CH_AAL)->vlddes;
 	struct rx_descriptor reg_desc;
-	int conn;
+	struct connection *p_conn;
 	struct atm_vcc *vcc;
 	struct sk_buff *skb, *new_skb;
 	struct rx_inband_trailer *trailer;
 	unsigned int i;
 
+	if ( vlddes > budget )
+		vlddes = budget;
+
 	for ( i = 0; i < vlddes; i++ ) {
 		unsigned int loop_count = 0;
 
@@ -965,10 +1077,10 @@ static inline void mailbox_aal_rx_handler(void)
 		} while ( reg_desc.own || !reg_desc.c );    //  keep test OWN and C bit until data is ready
 		ASSERT(loop_count == 1, "loop_count = %u, own = %d, c = %d, aal_desc_pos = %u", loop_count, (int)reg_desc.own, (int)reg_desc.c, g_atm_priv_data.aal_desc_pos);
 
-		conn = reg_desc.id;
+		p_conn = &g_atm_priv_data.conn[reg_desc.id];
 
-		if ( g_atm_priv_data.conn[conn].vcc != NULL ) {
-			vcc = g_atm_priv_data.conn[conn].vcc;
+		if ( p_conn->vcc != NULL ) {
+			vcc = p_conn->vcc;
 
 			skb = get_skb_rx_pointer(reg_desc.dataptr);
 
@@ -976,16 +1088,36 @@ static inline void mailbox_aal_rx_handler(void)
 				if ( vcc->qos.aal == ATM_AAL5 ) {
 					trailer = (struct rx_inband_trailer *)((unsigned int)skb->data + ((reg_desc.byteoff + reg_desc.datalen + MAX_RX_PACKET_PADDING_BYTES) & ~MAX_RX_PACKET_PADDING_BYTES));
 					if ( trailer->stw_crc )
-						g_atm_priv_data.conn[conn].aal5_vcc_crc_err++;
+						p_conn->aal5_vcc_crc_err++;
 					if ( trailer->stw_ovz )
-						g_atm_priv_data.conn[conn].aal5_vcc_oversize_sdu++;
+						p_conn->aal5_vcc_oversize_sdu++;
 					g_atm_priv_data.wrx_drop_pdu++;
 				}
+				p_conn->rx_drop_pdu++;
 				if ( vcc->stats ) {
 					atomic_inc(&vcc->stats->rx_drop);
 					atomic_inc(&vcc->stats->rx_err);
 				}
 				reg_desc.err = 0;
+			} else if ( reg_desc.datalen <= rx_copybreak ) {
+				/*  small frame: copy it out and hand the DMA buffer straight back  */
+				new_skb = napi_alloc_skb(&g_atm_napi, reg_desc.datalen);
+				if ( new_skb != NULL && atm_charge(vcc, new_skb->truesize) ) {
+#if defined(ENABLE_LESS_CACHE_INV) && ENABLE_LESS_CACHE_INV
+					if ( reg_desc.byteoff + reg_desc.datalen > LESS_CACHE_INV_LEN )
+						dma_cache_inv((unsigned long)skb->data + LESS_CACHE_INV_LEN, reg_desc.byteoff + reg_desc.datalen - LESS_CACHE_INV_LEN);
+#endif
+					memcpy(skb_put(new_skb, reg_desc.datalen), skb->data + reg_desc.byteoff, reg_desc.datalen);
+					p_conn->rx_copybreak++;
+					/*  drop the lines we just read before the PPE writes again */
+					dma_cache_inv((unsigned long)skb->data, reg_desc.byteoff + reg_desc.datalen);
+
+					aal_rx_push(p_conn, new_skb);
+				} else {
+					if ( new_skb != NULL )
+						dev_kfree_skb_any(new_skb);
+					aal_rx_drop(p_conn);
+				}
 			} else if ( atm_charge(vcc, skb->truesize) ) {
 				new_skb = alloc_skb_rx();
 				if ( new_skb != NULL ) {
@@ -996,29 +1128,16 @@ static inline void mailbox_aal_rx_handler(void)
 
 					skb_reserve(skb, reg_desc.byteoff);
 					skb_put(skb, reg_desc.datalen);
-					ATM_SKB(skb)->vcc = vcc;
-
-					vcc->push(vcc, skb);
 
-					if ( vcc->qos.aal == ATM_AAL5 )
-						g_atm_priv_data.wrx_pdu++;
-					if ( vcc->stats )
-						atomic_inc(&vcc->stats->rx);
-					adsl_led_flash();
+					aal_rx_push(p_conn, skb);
 
 					reg_desc.dataptr = (unsigned int)new_skb->data >> 2;
 				} else {
 					atm_return(vcc, skb->truesize);
-					if ( vcc->qos.aal == ATM_AAL5 )
-						g_atm_priv_data.wrx_drop_pdu++;
-					if ( vcc->stats )
-						atomic_inc(&vcc->stats->rx_drop);
+					aal_rx_drop(p_conn);
 				}
 			} else {
-				if ( vcc->qos.aal == ATM_AAL5 )
-					g_atm_priv_data.wrx_drop_pdu++;
-				if ( vcc->stats )
-					atomic_inc(&vcc->stats->rx_drop);
+				aal_rx_drop(p_conn);
 			}
 		} else {
 			g_atm_priv_data.wrx_drop_pdu++;
@@ -1035,15 +1154,17 @@ static inline void mailbox_aal_rx_handler(void)
 
 		mailbox_signal(RX_DMA_CH_AAL, 0);
 	}
+
+	return vlddes;
 }
 
-static void do_ppe_tasklet(unsigned long data)
+static int ppe_napi_poll(struct napi_struct *napi, int budget)
 {
 	unsigned int irqs = *MBOX_IGU1_ISR;
-	*MBOX_IGU1_ISRC = *MBOX_IGU1_ISR;
+	int work_done;
+
+	*MBOX_IGU1_ISRC = irqs;
 
-	if (irqs & (1 << RX_DMA_CH_AAL))
-		mailbox_aal_rx_handler();
 	if (irqs & (1 << RX_DMA_CH_OAM))
 		mailbox_oam_rx_handler();
 
@@ -1051,12 +1172,27 @@ static void do_ppe_tasklet(unsigned long data)
 	if ((irqs >> (FIRST_QSB_QID + 16)) & g_atm_priv_data.conn_table)
 		mailbox_tx_handler(irqs >> (FIRST_QSB_QID + 16));
 
-	if ((*MBOX_IGU1_ISR & ((1 << RX_DMA_CH_AAL) | (1 << RX_DMA_CH_OAM))) != 0)
-		tasklet_schedule(&g_dma_tasklet);
-	else if (*MBOX_IGU1_ISR >> (FIRST_QSB_QID + 16)) /* TX queue */
-		tasklet_schedule(&g_dma_tasklet);
-	else
-		enable_irq(PPE_MAILBOX_IGU1_INT);
+	/*
+	 * AAL descriptors left over from a previous poll no longer have their
+	 * ISR bit set, so the ring is always checked. Only AAL5 frames count
+	 * against the budget, OAM cells and TX completions are cheap.
+	 */
+	work_done = mailbox_aal_rx_handler(budget);
+
+	refill_skb_rx_pool();
+
+	if (work_done < budget) {
+		napi_complete_done(napi, work_done);
+
+		if ((*MBOX_IGU1_ISR & ((1 << RX_DMA_CH_AAL) | (1 << RX_DMA_CH_OAM))) != 0)
+			napi_reschedule(napi);
+		else if (*MBOX_IGU1_ISR >> (FIRST_QSB_QID + 16)) /* TX queue */
+			napi_reschedule(napi);
+		else
+			enable_irq(PPE_MAILBOX_IGU1_INT);
+	}
+
+	return work_done;
 }
 
 static irqreturn_t mailbox_irq_handler(int irq, void *dev_id)
@@ -1065,7 +1201,7 @@ static irqreturn_t mailbox_irq_handler(int irq, void *dev_id)
 		return IRQ_HANDLED;
 
 	disable_irq_nosync(PPE_MAILBOX_IGU1_INT);
-	tasklet_schedule(&g_dma_tasklet);
+	napi_schedule(&g_atm_napi);
 
 	return IRQ_HANDLED;
 }
@@ -1419,6 +1555,18 @@ static inline void check_parameters(void)
 
 	if ( dma_tx_descriptor_length < 2 )
 		dma_tx_descriptor_length = 2;
+
+	if ( napi_weight < 1 )
+		napi_weight = 1;
+	else if ( napi_weight > dma_rx_descriptor_length )
+		napi_weight = dma_rx_descriptor_length;
+	/*  netif_napi_add() warns about weights above NAPI_POLL_WEIGHT */
+	if ( napi_weight > NAPI_POLL_WEIGHT )
+		napi_weight = NAPI_POLL_WEIGHT;
+	if ( rx_copybreak < 0 )
+		rx_copybreak = 0;
+	else if ( rx_copybreak > RX_DMA_CH_AAL_BUF_SIZE )
+		rx_copybreak = RX_DMA_CH_AAL_BUF_SIZE;
 }
 
 static inline int init_priv_data(void)
@@ -1432,6 +1580,7 @@ static inline int init_priv_data(void)
 
 	//  clear atm private data structure
 	memset(&g_atm_priv_data, 0, sizeof(g_atm_priv_data));
+	skb_queue_head_init(&g_atm_priv_data.rx_skb_pool);
 
 	//  allocate memory for RX (AAL) descriptors
 	p = kzalloc(dma_rx_descriptor_length * sizeof(struct rx_descriptor) + DESC_ALIGNMENT, GFP_KERNEL);
@@ -1519,6 +1668,8 @@ static inline int init_priv_data(void)
 	for ( i = 0; i < ATM_PORT_NUMBER; i++ )
 		g_atm_priv_data.port[i].tx_max_cell_rate = DEFAULT_TX_LINK_RATE;
 
+	refill_skb_rx_pool();
+
 	return 0;
 }
 
@@ -1556,6 +1707,8 @@ static inline void clear_priv_data(void)
 		}
 		kfree(g_atm_priv_data.aal_desc_base);
 	}
+
+	skb_queue_purge(&g_atm_priv_data.rx_skb_pool);
 }
 
 static inline void init_rx_tables(void)
@@ -1839,6 +1992,10 @@ static int ltq_atm_probe(struct platform_device *pdev)
 		}
 	}
 
+	init_dummy_netdev(&g_atm_napi_dev);
+	netif_napi_add(&g_atm_napi_dev, &g_atm_napi, ppe_napi_poll, napi_weight);
+	napi_enable(&g_atm_napi);
+
 	/*  register interrupt handler  */
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4,1,0)
 	ret = request_irq(PPE_MAILBOX_IGU1_INT, mailbox_irq_handler, 0, "atm_mailbox_isr", &g_atm_priv_data);
@@ -1885,6 +2042,8 @@ static int ltq_atm_probe(struct platform_device *pdev)
 PP32_START_FAIL:
 	free_irq(PPE_MAILBOX_IGU1_INT, &g_atm_priv_data);
 REQUEST_IRQ_PPE_MAILBOX_IGU1_INT_FAIL:
+	napi_disable(&g_atm_napi);
+	netif_napi_del(&g_atm_napi);
 ATM_DEV_REGISTER_FAIL:
 	while ( port_num-- > 0 )
 		atm_dev_deregister(g_atm_priv_data.port[port_num].dev);
@@ -1908,6 +2067,9 @@ static int ltq_atm_remove(struct platform_device *pdev)
 
 	free_irq(PPE_MAILBOX_IGU1_INT, &g_atm_priv_data);
 
+	napi_disable(&g_atm_napi);
+	netif_napi_del(&g_atm_napi);
+
 	for ( port_num = 0; port_num < ATM_PORT_NUMBER; port_num++ )
 		atm_dev_deregister(g_atm_priv_data.port[port_num].dev);
 
@@ -80,11 +80,6 @@ spinlock_t aes_lock;
 
 /* Definition of constants */
 #define AES_START   IFX_AES_CON
-#define AES_MIN_KEY_SIZE    16
-#define AES_MAX_KEY_SIZE    32
-#define AES_BLOCK_SIZE      16
-#define CTR_RFC3686_NONCE_SIZE    4
-#define CTR_RFC3686_IV_SIZE       8
 #define CTR_RFC3686_MAX_KEY_SIZE  (AES_MAX_KEY_SIZE + CTR_RFC3686_NONCE_SIZE)
 
 #ifdef CRYPTO_DEBUG
@@ -105,17 +100,8 @@ int aes_memory_allocate(int value);
 int des_memory_allocate(int value);
 void memory_release(u32 *addr); 
 
-
-extern void ifx_deu_aes (void *ctx_arg, uint8_t *out_arg, const uint8_t *in_arg,
-        uint8_t *iv_arg, size_t nbytes, int encdec, int mode);
 /* End of function decleration */
 
-struct aes_ctx {
-    int key_length;
-    u32 buf[AES_MAX_KEY_SIZE];
-    u8 nonce[CTR_RFC3686_NONCE_SIZE];
-};
-
 extern int disable_deudma;
 extern int disable_multiblock; 
 
@@ -178,6 +164,9 @@ void ifx_deu_aes (void *ctx_arg, u8 *out_arg, const u8 *in_arg,
 
 
     CRTCL_SECT_START;
+#ifdef CONFIG_CRYPTO_DEV_DMA
+    deu_dma_wait_idle();
+#endif
     /* 128, 192 or 256 bit key length */
     aes->controlr.K = key_len / 8 - 2;
         if (key_len == 128 / 8) {
@@ -40,30 +40,24 @@
  \brief IFX DES driver Functions
 */
 
-#include <linux/wait.h>
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/types.h>
+#include <linux/errno.h>
 #include <linux/crypto.h>
 #include <linux/kernel.h>
-#include <linux/interrupt.h>
 #include <linux/spinlock.h>
-#include <linux/list.h>
-#include <crypto/ctr.h>
-#include <crypto/aes.h>
+#include <crypto/des.h>
 #include <crypto/algapi.h>
 #include <crypto/scatterwalk.h>
-
-#include <asm/ifx/ifx_regs.h>
-#include <asm/ifx/ifx_types.h>
-#include <asm/ifx/common_routines.h>
-#include <asm/ifx/irq.h>
-#include <asm/ifx/ifx_pmu.h>
-#include <asm/ifx/ifx_gpio.h>
-#include <asm/kmap_types.h>
+#include <crypto/internal/skcipher.h>
 
 #include "ifxmips_deu.h"
+#include "ifxmips_deu_dma.h"
 
 #if defined(CONFIG_DANUBE)
 #include "ifxmips_deu_danube.h"
-extern int ifx_danube_pre_1_4;
 #elif defined(CONFIG_AR9)
 #include "ifxmips_deu_ar9.h"
 #elif defined(CONFIG_VR9) || defined(CONFIG_AR10)
@@ -72,883 +66,239 @@ extern int ifx_danube_pre_1_4;
 #error "Unkown platform"
 #endif
 
-/* DMA specific header and variables */
-
-spinlock_t des_lock;
-#define CRTCL_SECT_INIT        spin_lock_init(&des_lock)
-#define CRTCL_SECT_START       spin_lock_irqsave(&des_lock, flag)
-#define CRTCL_SECT_END         spin_unlock_irqrestore(&des_lock, flag)
-
-/* Preprocessor declerations */
-#ifdef CRYPTO_DEBUG
-extern char debug_level;
-#define DPRINTF(level, format, args...) if (level < debug_level) printk(KERN_INFO "[%s %s %d]: " format, __FILE__, __func__, __LINE__, ##args);
-#else
-#define DPRINTF(level, format, args...)
-#endif
-//#define DES_3DES_START  IFX_DES_CON
-#define DES_KEY_SIZE            8
-#define DES_EXPKEY_WORDS        32
-#define DES_BLOCK_SIZE          8
-#define DES3_EDE_KEY_SIZE       (3 * DES_KEY_SIZE)
-#define DES3_EDE_EXPKEY_WORDS   (3 * DES_EXPKEY_WORDS)
-#define DES3_EDE_BLOCK_SIZE     DES_BLOCK_SIZE
-
-/* Function Declaration to prevent warning messages */
-void des_chip_init (void);
-u32 endian_swap(u32 input);
-u32 input_swap(u32 input);
-int aes_memory_allocate(int value);
-int des_memory_allocate(int value);
-void memory_release(u32 *buffer);
-u32* memory_alignment(const u8 *arg, u32 *buff_alloc, int in_out, int nbytes);
-void aes_dma_memory_copy(u32 *outcopy, u32 *out_dma, u8 *out_arg, int nbytes);
-void des_dma_memory_copy(u32 *outcopy, u32 *out_dma, u8 *out_arg, int nbytes);
-
-static int lq_deu_des_core (void *ctx_arg, u8 *out_arg, const u8 *in_arg,
-             u8 *iv_arg, u32 nbytes, int encdec, int mode);
-
-struct des_ctx {
-        int controlr_M;
-        int key_length;
-        u8 iv[DES_BLOCK_SIZE];
-        u32 expkey[DES3_EDE_EXPKEY_WORDS];
-};
-
-
-static int disable_multiblock = 0;
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,4,0)
-module_param(disable_multiblock, int, 0);
-#else
-MODULE_PARM_DESC(disable_multiblock, "Disable encryption of whole multiblock buffers");
-#endif
-
-static int disable_deudma = 1;
-
-struct des_container {
-    u8 *iv;
-    u8 *dst_buf;
-    u8 *src_buf;
-    int mode;
-    int encdec;
-    int complete;
-    int flag;
-
-    u32 bytes_processed;
-    u32 nbytes;
-
-    struct ablkcipher_request arequest;
-};
-
-des_priv_t *des_queue;
-extern deu_drv_priv_t deu_dma_priv;
-
-void hexdump1(unsigned char *buf, unsigned int len)
-{
-        print_hex_dump(KERN_CONT, "", DUMP_PREFIX_OFFSET,
-                        16, 1,
-                        buf, len, false);
-}
-
-
-/*! \fn int lq_des_setkey(struct crypto_ablkcipher *tfm, const u8 *key, unsigned int keylen)
- *  \ingroup IFX_DES_FUNCTIONS
- *  \brief sets DES key
- *  \param tfm linux crypto algo transform
- *  \param key input key
- *  \param keylen key length
-*/
-static int lq_des_setkey(struct crypto_ablkcipher *tfm, const u8 *key,
-                         unsigned int keylen)
-{
-        struct des_ctx *dctx = crypto_ablkcipher_ctx(tfm);
-
-        //printk("setkey in %s\n", __FILE__);
-
-        dctx->controlr_M = 0;   // des
-        dctx->key_length = keylen;
-
-        memcpy ((u8 *) (dctx->expkey), key, keylen);
-
-        return 0;
-}
-
-/*! \fn int lq_des3_ede_setkey(struct crypto_ablkcipher *tfm, const u8 *key, unsigned int keylen)
- *  \ingroup IFX_DES_FUNCTIONS
- *  \brief sets DES key
- *  \param tfm linux crypto algo transform
- *  \param key input key
- *  \param keylen key length
-*/
-
-static int lq_des3_ede_setkey(struct crypto_ablkcipher *tfm, const u8 *in_key,
-                      unsigned int keylen)
-{
-    struct des_ctx *dctx = crypto_ablkcipher_ctx(tfm);
-
-    //printk("setkey in %s\n", __FILE__);
-
-    dctx->controlr_M = keylen/8 + 1;   // des
-    dctx->key_length = keylen;
+#define DES_3DES_START  IFX_DES_CON
 
-    memcpy ((u8 *) (dctx->expkey), in_key, keylen);
+#define DES_MODE_ECB    0
+#define DES_MODE_CBC    1
 
-    return 0;
-}
-
-/*! \fn void ifx_deu_des_core(void *ctx_arg, u8 *out_arg, const u8 *in_arg, u8 *iv_arg, u32 nbytes, int encdec, int mode)
+/*! \fn static void lq_deu_des_setup(struct skcipher_request *req)
  *  \ingroup IFX_DES_FUNCTIONS
- *  \brief main interface to DES hardware
- *  \param ctx_arg crypto algo context
- *  \param out_arg output bytestream
- *  \param in_arg input bytestream
- *  \param iv_arg initialization vector
- *  \param nbytes length of bytestream
- *  \param encdec 1 for encrypt; 0 for decrypt
- *  \param mode operation mode such as ebc, cbc
+ *  \brief program key, mode and IV for a DMA transfer, called by the DMA engine with des_lock held
+ *  \param req skcipher request
 */
-
-static int lq_deu_des_core (void *ctx_arg, u8 *out_arg, const u8 *in_arg,
-             u8 *iv_arg, u32 nbytes, int encdec, int mode)
+static void lq_deu_des_setup(struct skcipher_request *req)
 {
         volatile struct des_t *des = (struct des_t *) DES_3DES_START;
-        struct des_ctx *dctx = ctx_arg;
+        struct des_ctx *dctx = crypto_skcipher_ctx(crypto_skcipher_reqtfm(req));
+        struct deu_dma_reqctx *rctx = skcipher_request_ctx(req);
         u32 *key = dctx->expkey;
-        unsigned long flag;
-
-        int i = 0;
-        int nblocks = 0;
-
-        CRTCL_SECT_START;
 
         des->controlr.M = dctx->controlr_M;
-        if (dctx->controlr_M == 0)      // des
-        {
-                des->K1HR = DEU_ENDIAN_SWAP(*((u32 *) key + 0));
-                des->K1LR = DEU_ENDIAN_SWAP(*((u32 *) key + 1));
-
-        }
-        else {
-                /* Hardware Section */
-                switch (dctx->key_length) {
-                case 24:
-                        des->K3HR = DEU_ENDIAN_SWAP(*((u32 *) key + 4));
-                        des->K3LR = DEU_ENDIAN_SWAP(*((u32 *) key + 5));
-                        /* no break; */
-
-                case 16:
-                        des->K2HR = DEU_ENDIAN_SWAP(*((u32 *) key + 2));
-                        des->K2LR = DEU_ENDIAN_SWAP(*((u32 *) key + 3));
-
-                        /* no break; */
-                case 8:
-                        des->K1HR = DEU_ENDIAN_SWAP(*((u32 *) key + 0));
-                        des->K1LR = DEU_ENDIAN_SWAP(*((u32 *) key + 1));
-                        break;
-
-                default:
-                        CRTCL_SECT_END;
-                        return -EINVAL;
-                }
+        des->K3HR = DEU_ENDIAN_SWAP(*((u32 *) key + 4));
+        des->K3LR = DEU_ENDIAN_SWAP(*((u32 *) key + 5));
+        des->K2HR = DEU_ENDIAN_SWAP(*((u32 *) key + 2));
+        des->K2LR = DEU_ENDIAN_SWAP(*((u32 *) key + 3));
+        des->K1HR = DEU_ENDIAN_SWAP(*((u32 *) key + 0));
+        des->K1LR = DEU_ENDIAN_SWAP(*((u32 *) key + 1));
+
+        des->controlr.E_D = !rctx->encdec;
+        des->controlr.O = rctx->mode; //0 ECB 1 CBC 2 OFB 3 CFB 4 CTR
+
+        if (rctx->mode > 0) {
+                des->IVHR = DEU_ENDIAN_SWAP(*(u32 *) req->iv);
+                des->IVLR = DEU_ENDIAN_SWAP(*((u32 *) req->iv + 1));
         }
 
-        des->controlr.E_D = !encdec;    //encryption
-        des->controlr.O = mode; //0 ECB 1 CBC 2 OFB 3 CFB 4 CTR hexdump(prin,sizeof(*des));
-
-        if (mode > 0) {
-                des->IVHR = DEU_ENDIAN_SWAP(*(u32 *) iv_arg);
-                des->IVLR = DEU_ENDIAN_SWAP(*((u32 *) iv_arg + 1));
-        };
-
-    /* memory alignment issue */
-    dword_mem_aligned_in = (u32 *) DEU_DWORD_REORDERING(in_arg, des_buff_in, BUFFER_IN, nbytes);
-    
-    deu_priv->deu_rx_buf = (u32 *) out_arg;
-    deu_priv->deu_rx_len = nbytes;
-
-    dma->controlr.ALGO = 0;       //DES
-    des->controlr.DAU = 0;
-    dma->controlr.BS = 0;
-    dma->controlr.EN = 1;
-
-    while (des->controlr.BUS) {
-    };
+        des->controlr.DAU = 0;
 
-    wlen = dma_device_write (dma_device, (u8 *) dword_mem_aligned_in, nbytes, NULL);
-    if (wlen != nbytes) {
-        dma->controlr.EN = 0;
-        CRTCL_SECT_END;
-        printk (KERN_ERR "[%s %s %d]: dma_device_write fail!\n", __FILE__, __func__, __LINE__);
-        return -EINVAL;
-    }
-
-
-    /* Prepare Rx buf length used in dma psuedo interrupt */
-    outcopy = (u32 *) DEU_DWORD_REORDERING(out_arg, des_buff_out, BUFFER_OUT, nbytes);
-    deu_priv->outcopy = outcopy;
-    deu_priv->event_src = DES_ASYNC_EVENT;
-     
-    if (mode > 0) {
-        *(u32 *) iv_arg = DEU_ENDIAN_SWAP(des->IVHR);
-        *((u32 *) iv_arg + 1) = DEU_ENDIAN_SWAP(des->IVLR);
-    };
-
-    CRTCL_SECT_END; 
-
-    return -EINPROGRESS;
-
-}
-
-static int count_sgs(struct scatterlist *sl, unsigned int total_bytes)
-{
-        int i = 0;
-
-        do {
-                total_bytes -= sl[i].length;
-                i++;
-
-        } while (total_bytes > 0);
-
-        return i;
+        while (des->controlr.BUS) {
+                // wait for DES to be ready
+        }
 }
 
-/* \fn static inline struct des_container *des_container_cast (
- *                     struct scatterlist *dst)
- * \ingroup IFX_DES_FUNCTIONS
- * \brief Locate the structure des_container in memory.
- * \param *areq Pointer to memory location where ablkcipher_request is located
- * \return *des_cointainer The function pointer to des_container
+/*! \fn static void lq_deu_des_done(struct skcipher_request *req)
+ *  \ingroup IFX_DES_FUNCTIONS
+ *  \brief hand the chaining value of the finished request back in req->iv
+ *  \param req skcipher request
 */
-
-static inline struct des_container *des_container_cast(
-                        struct ablkcipher_request *areq)
+static void lq_deu_des_done(struct skcipher_request *req)
 {
-    return container_of(areq, struct des_container, arequest);
-}
+        struct deu_dma_reqctx *rctx = skcipher_request_ctx(req);
 
-/* \fn static void lq_sg_complete(struct des_container *des_con)
- * \ingroup IFX_DES_FUNCTIONS
- * \brief Free the used up memory after encryt/decrypt.
-*/
+        if (rctx->mode != DES_MODE_CBC)
+                return;
 
-static void lq_sg_complete(struct des_container *des_con)
-{
-    unsigned long queue_flag;
-  
-    spin_lock_irqsave(&des_queue->lock, queue_flag);
-    kfree(des_con); 
-    spin_unlock_irqrestore(&des_queue->lock, queue_flag);
+        if (rctx->encdec == CRYPTO_DIR_ENCRYPT)
+                scatterwalk_map_and_copy(req->iv, req->dst,
+                                         req->cryptlen - DES_BLOCK_SIZE,
+                                         DES_BLOCK_SIZE, 0);
+        else
+                memcpy(req->iv, rctx->iv, DES_BLOCK_SIZE);
 }
 
-/* \fn void lq_sg_init(struct scatterlist *src,
- *                     struct scatterlist *dst)
- * \ingroup IFX_DES_FUNCTIONS
- * \brief Maps the scatterlists into a source/destination page.
- * \param *src Pointer to the source scatterlist
- * \param *dst Pointer to the destination scatterlist
+/*! \fn static void lq_deu_des_pio(struct skcipher_request *req, u8 *buf, unsigned int len, u8 *iv)
+ *  \ingroup IFX_DES_FUNCTIONS
+ *  \brief fallback for requests the DMA engine could not map
 */
-
-static void lq_sg_init(struct des_container *des_con, struct scatterlist *src,
-                       struct scatterlist *dst)
+static void lq_deu_des_pio(struct skcipher_request *req, u8 *buf,
+                           unsigned int len, u8 *iv)
 {
-    struct page *dst_page, *src_page;
-
-    src_page = sg_virt(src);
-    des_con->src_buf = (char *) src_page;
+        struct des_ctx *dctx = crypto_skcipher_ctx(crypto_skcipher_reqtfm(req));
+        struct deu_dma_reqctx *rctx = skcipher_request_ctx(req);
 
-    dst_page = sg_virt(dst);
-    des_con->dst_buf = (char *) dst_page;
+        ifx_deu_des(dctx, buf, buf, iv, len, rctx->encdec, rctx->mode);
 }
 
-/* \fn static int process_next_packet(struct des_container *des_con,  struct ablkcipher_request *areq,
- *                                     int state)
- * \ingroup IFX_DES_FUNCTIONS
- * \brief Process the next packet after dequeuing the packet from crypto queue
- * \param *des_con  Pointer to DES container structure
- * \param *areq     Pointer to ablkcipher_request container
- * \param state     State of the packet (scattered packet or new packet to be processed)
- * \return -EINVAL: DEU failure, -EINPROGRESS: DEU encrypt/decrypt in progress, 1: no scatterlist left
-*/
-
-static int process_next_packet(struct des_container *des_con,  struct ablkcipher_request *areq,
-                               int state) 
-{
-    u8 *iv;
-    int mode, encdec, err = -EINVAL;
-    u32 remain, inc, chunk_size, nbytes;
-    struct scatterlist *src = NULL;
-    struct scatterlist *dst = NULL;
-    struct crypto_ablkcipher *cipher;
-    struct des_ctx *ctx;
-    unsigned long queue_flag;
-
-    spin_lock_irqsave(&des_queue->lock, queue_flag);
-
-    mode = des_con->mode;
-    encdec = des_con->encdec;
-    iv = des_con->iv;
-
-    if (state & PROCESS_SCATTER) {
-        src = scatterwalk_sg_next(areq->src);
-        dst = scatterwalk_sg_next(areq->dst);
-
-        if (!src || !dst) {
-            spin_unlock_irqrestore(&des_queue->lock, queue_flag);
-      	    return 1;
-        }
-    }
-    else if (state & PROCESS_NEW_PACKET) {
-        src = areq->src;
-        dst = areq->dst;
-    }
-
-    remain = des_con->bytes_processed;
-    chunk_size = src->length;
-
-    //printk("debug ln: %d, func: %s, reqsize: %d, scattersize: %d\n", 
-//		__LINE__, __func__, areq->nbytes, chunk_size);
-
-    if (remain > DEU_MAX_PACKET_SIZE)
-        inc = DEU_MAX_PACKET_SIZE;
-    else if(remain > chunk_size)
-        inc = chunk_size;
-    else
-        inc = remain;
- 
-    remain -= inc;
-    des_con->nbytes = inc;
-    
-    if (state & PROCESS_SCATTER) {
-        des_con->src_buf += des_con->nbytes;
-        des_con->dst_buf += des_con->nbytes;
-    } 
-
-    lq_sg_init(des_con, src, dst);
-
-    nbytes = des_con->nbytes;
-
-    cipher = crypto_ablkcipher_reqtfm(areq);
-    ctx = crypto_ablkcipher_ctx(cipher);
-
-    if (des_queue->hw_status == DES_IDLE) {
-        des_queue->hw_status = DES_STARTED;
-    }
-    
-    des_con->bytes_processed -= des_con->nbytes;
-    err = ablkcipher_enqueue_request(&des_queue->list, &des_con->arequest);
-    if (err == -EBUSY) {
-        printk("Failed to enqueue request, ln: %d, err: %d\n",
-               __LINE__, err);
-        spin_unlock_irqrestore(&des_queue->lock, queue_flag);
-        return -EINVAL;
-    }
-
-    spin_unlock_irqrestore(&des_queue->lock, queue_flag);
-    err = lq_deu_des_core(ctx, des_con->dst_buf, des_con->src_buf, iv, nbytes, encdec, mode);
- 
-    return err;
-}
+static const struct deu_dma_ops lq_deu_des_ops = {
+        .algo           = DEU_DMA_ALGO_DES,
+        .blocksize      = DES_BLOCK_SIZE,
+        .setup          = lq_deu_des_setup,
+        .done           = lq_deu_des_done,
+        .pio            = lq_deu_des_pio,
+};
 
-/* \fn static void process_queue(unsigned long data)
- * \ingroup IFX_DES_FUNCTIONS
- * \brief Process next packet in queue
- * \param data not used
- * \return 
+/*! \fn static int lq_des_queue_mgr(struct skcipher_request *req, int dir, int mode)
+ *  \ingroup IFX_DES_FUNCTIONS
+ *  \brief prepare the request context and pass the request to the DMA engine
+ *  \param req skcipher request
+ *  \param dir Encrypt/Decrypt
+ *  \param mode The mode DES algo is running
+ *  \return -EINPROGRESS/-EBUSY if queued, 0 for empty requests, -EINVAL for bad lengths
 */
-
-static void process_queue(unsigned long data)
+static int lq_des_queue_mgr(struct skcipher_request *req, int dir, int mode)
 {
-      DEU_WAKEUP_EVENT(deu_dma_priv.deu_thread_wait, DES_ASYNC_EVENT,
-                deu_dma_priv.des_event_flags);
+        struct deu_dma_reqctx *rctx = skcipher_request_ctx(req);
 
-}
+        if (!req->cryptlen)
+                return 0;
 
-/* \fn static int des_crypto_thread (void *data)
- * \ingroup IFX_DES_FUNCTIONS
- * \brief DES thread that handles crypto requests from upper layer & DMA
- * \param *data Not used
- * \return -EINVAL: DEU failure, -EBUSY: DEU HW busy, 0: exit thread
-*/
+        if (req->cryptlen % DES_BLOCK_SIZE)
+                return -EINVAL;
 
-static int des_crypto_thread(void *data)
-{
-    struct des_container *des_con = NULL;
-    struct ablkcipher_request *areq = NULL;
-    int err;
-    unsigned long queue_flag;
-
-    daemonize("lq_des_thread");
-   
-    while (1)
-    {  
-       DEU_WAIT_EVENT(deu_dma_priv.deu_thread_wait, DES_ASYNC_EVENT, 
-                       deu_dma_priv.des_event_flags);
-       spin_lock_irqsave(&des_queue->lock, queue_flag);
-
-       /* wait to prevent starting a crypto session before 
-        * exiting the dma interrupt thread.
-        */
-       
-       if (des_queue->hw_status == DES_STARTED) {
-            areq = ablkcipher_dequeue_request(&des_queue->list);
-            des_con = des_container_cast(areq);
-            des_queue->hw_status = DES_BUSY;
-       }
-       else if (des_queue->hw_status == DES_IDLE) {
-            areq = ablkcipher_dequeue_request(&des_queue->list);
-            des_con = des_container_cast(areq);
-            des_queue->hw_status = DES_STARTED;
-       }
-       else if (des_queue->hw_status == DES_BUSY) {
-            areq = ablkcipher_dequeue_request(&des_queue->list);
-            des_con = des_container_cast(areq);
-       }
-       else if (des_queue->hw_status == DES_COMPLETED) {
-            areq->base.complete(&areq->base, 0);
-            lq_sg_complete(des_con);
-            des_queue->hw_status = DES_IDLE;
-            spin_unlock_irqrestore(&des_queue->lock, queue_flag);
-            return 0;
-       }
-       spin_unlock_irqrestore(&des_queue->lock, queue_flag);
-            
-       if ((des_con->bytes_processed == 0)) {
-            goto des_done;
-       }
-
-       if (!des_con) {
-           goto des_done;
-       }
-
-       if (des_con->flag & PROCESS_NEW_PACKET) { 
-           des_con->flag = PROCESS_SCATTER;
-           err = process_next_packet(des_con, areq, PROCESS_NEW_PACKET);  
-       }
-       else
-           err = process_next_packet(des_con, areq, PROCESS_SCATTER);  
-       
-       if (err == -EINVAL) {
-           areq->base.complete(&areq->base, err);
-           lq_sg_complete(des_con);
-           printk("src/dst returned -EINVAL in func: %s\n", __func__);
-       }
-       else if (err > 0) { 
-           printk("src/dst returned zero in func: %s\n", __func__);
-           goto des_done;
-       }
-
-       continue;
-   
-des_done:
-       //printk("debug line - %d, func: %s, qlen: %d\n", __LINE__, __func__, des_queue->list.qlen);
-       areq->base.complete(&areq->base, 0);
-       lq_sg_complete(des_con);
-
-       spin_lock_irqsave(&des_queue->lock, queue_flag);
-       if (des_queue->list.qlen > 0) {
-           spin_unlock_irqrestore(&des_queue->lock, queue_flag);
-           tasklet_schedule(&des_queue->des_task);
-       } 
-       else {
-           des_queue->hw_status = DES_IDLE;
-           spin_unlock_irqrestore(&des_queue->lock, queue_flag);
-       }
-    } // while(1)
-    
-    return 0;
+        rctx->ops = &lq_deu_des_ops;
+        rctx->encdec = dir;
+        rctx->mode = mode;
+
+        /* in-place decryption overwrites the next chaining value */
+        if (mode == DES_MODE_CBC && dir == CRYPTO_DIR_DECRYPT)
+                scatterwalk_map_and_copy(rctx->iv, req->src,
+                                         req->cryptlen - DES_BLOCK_SIZE,
+                                         DES_BLOCK_SIZE, 0);
 
+        return deu_dma_enqueue(req);
 }
 
-/* \fn static int lq_des_queue_mgr(struct des_ctx *ctx, struct ablkcipher_request *areq,
-                            u8 *iv, int encdec, int mode)
- * \ingroup IFX_DES_FUNCTIONS
- * \brief starts the process of queuing DEU requests
- * \param *ctx crypto algo contax
- * \param *areq Pointer to the balkcipher requests
- * \param *iv Pointer to intput vector location
- * \param dir Encrypt/Decrypt
- * \mode The mode DES algo is running
- * \return 0 if success
+/*! \fn static int des3_ede_setkey(struct crypto_skcipher *tfm, const u8 *key, unsigned int keylen)
+ *  \ingroup IFX_DES_FUNCTIONS
+ *  \brief sets 3DES key
+ *  \param tfm skcipher transform
+ *  \param key input key
+ *  \param keylen key length
 */
-
-static int lq_queue_mgr(struct des_ctx *ctx, struct ablkcipher_request *areq, 
-                        u8 *iv, int encdec, int mode)
+static int des3_ede_setkey(struct crypto_skcipher *tfm, const u8 *key,
+                           unsigned int keylen)
 {
-    int err = -EINVAL;
-    unsigned long queue_flag;
-    struct scatterlist *src = areq->src;
-    struct scatterlist *dst = areq->dst;
-    struct des_container *des_con = NULL;
-    u32 remain, inc, nbytes = areq->nbytes;
-    u32 chunk_bytes = src->length;
-   
-    des_con = (struct des_container *)kmalloc(sizeof(struct des_container), 
-                                       GFP_KERNEL);
-
-    if (!(des_con)) {
-        printk("Cannot allocate memory for AES container, fn %s, ln %d\n",
-                __func__, __LINE__);
-        return -ENOMEM;
-    }
-  
-    /* DES encrypt/decrypt mode  */
-    if (mode == 5) {
-        nbytes = DES_BLOCK_SIZE;
-        chunk_bytes = DES_BLOCK_SIZE;
-        mode = 0;
-    }
-
-    des_con->bytes_processed = nbytes;
-    des_con->arequest = (*areq);
-    remain = nbytes;
-
-    //printk("debug - Line: %d, func: %s, reqsize: %d, scattersize: %d\n", 
-	//	__LINE__, __func__, nbytes, chunk_bytes);
-
-    if (remain > DEU_MAX_PACKET_SIZE)  
-        inc = DEU_MAX_PACKET_SIZE;
-    else if(remain > chunk_bytes)
-        inc = chunk_bytes;
-    else 
-        inc = remain;
-    
-    remain -= inc;
-    lq_sg_init(des_con, src, dst);
-     
-    if (remain <= 0 ) { 
-        des_con->complete = 1;
-    }
-    else 
-        des_con->complete = 0;
-        
-    des_con->nbytes = inc; 
-    des_con->iv = iv;
-    des_con->mode = mode;
-    des_con->encdec = encdec;
-
-    spin_lock_irqsave(&des_queue->lock, queue_flag);
-
-    if (des_queue->hw_status == DES_STARTED || des_queue->hw_status == DES_BUSY ||
-        des_queue->list.qlen > 0) {
-
-        des_con->flag = PROCESS_NEW_PACKET;
-        err = ablkcipher_enqueue_request(&des_queue->list, &des_con->arequest);
-        if (err == -EBUSY) {
-            spin_unlock_irqrestore(&des_queue->lock, queue_flag); 
-            printk("Fail to enqueue ablkcipher request ln: %d, err: %d\n",
-                   __LINE__, err);
-            return err;
-        }
-
-        spin_unlock_irqrestore(&des_queue->lock, queue_flag); 
-        return -EINPROGRESS;
-              
-    }
-    else if (des_queue->hw_status == DES_IDLE) {
-        des_queue->hw_status = DES_STARTED;            
-    }
-   
-    des_con->flag = PROCESS_SCATTER;
-    des_con->bytes_processed -= des_con->nbytes;
-
-    err = ablkcipher_enqueue_request(&des_queue->list, &des_con->arequest);
-    if (err == -EBUSY) {
-        printk("Fail to enqueue ablkcipher request ln: %d, err: %d\n",
-	       __LINE__, err);
-
-        spin_unlock_irqrestore(&des_queue->lock, queue_flag);
-        return err;
-     }
-                  
-     spin_unlock_irqrestore(&des_queue->lock, queue_flag); 
-     return lq_deu_des_core(ctx, des_con->dst_buf, des_con->src_buf, iv, inc, encdec, mode);
+        struct des_ctx *dctx = crypto_skcipher_ctx(tfm);
 
-}
+        if (keylen != DES3_EDE_KEY_SIZE) {
+                crypto_skcipher_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN);
+                return -EINVAL;
+        }
 
-/* \fn static int lq_des_encrypt(struct ablkcipher_request *areq)
- * \ingroup IFX_DES_FUNCTIONS
- * \brief Decrypt function for DES algo
- * \param *areq Pointer to ablkcipher request in memory
- * \return 0 is success, -EINPROGRESS if encryting, EINVAL if failure
-*/
-	
-static int lq_des_encrypt(struct ablkcipher_request *areq)
-{
-    struct crypto_ablkcipher *cipher = crypto_ablkcipher_reqtfm(areq);
-    struct des_ctx *ctx = crypto_ablkcipher_ctx(cipher);
+        dctx->controlr_M = keylen / 8 + 1;      // 3DES EDE1 / EDE2 / EDE3 Mode
+        dctx->key_length = keylen;
 
-    return lq_queue_mgr(ctx, areq, NULL, CRYPTO_DIR_ENCRYPT, 5);
+        memcpy ((u8 *) (dctx->expkey), key, keylen);
 
+        return 0;
 }
 
-/* \fn static int lq_des_decrypt(struct ablkcipher_request *areq)
- * \ingroup IFX_DES_FUNCTIONS
- * \brief Decrypt function for DES algo
- * \param *areq Pointer to ablkcipher request in memory
- * \return 0 is success, -EINPROGRESS if encryting, EINVAL if failure
+/*! \fn static int des_init_tfm(struct crypto_skcipher *tfm)
+ *  \ingroup IFX_DES_FUNCTIONS
+ *  \brief reserve the DMA request context
 */
-
-static int lq_des_decrypt(struct ablkcipher_request *areq)
+static int des_init_tfm(struct crypto_skcipher *tfm)
 {
-    struct crypto_ablkcipher *cipher = crypto_ablkcipher_reqtfm(areq);
-    struct des_ctx *ctx = crypto_ablkcipher_ctx(cipher);
-
-    return lq_queue_mgr(ctx, areq, NULL, CRYPTO_DIR_DECRYPT, 5);
+        crypto_skcipher_set_reqsize(tfm, sizeof(struct deu_dma_reqctx));
+        return 0;
 }
 
-/* \fn static int lq_ecb_des_encrypt(struct ablkcipher_request *areq)
- * \ingroup IFX_DES_FUNCTIONS
- * \brief Decrypt function for DES algo
- * \param *areq Pointer to ablkcipher request in memory
- * \return 0 is success, -EINPROGRESS if encryting, EINVAL if failure
-*/
-
-static int lq_ecb_des_encrypt(struct ablkcipher_request *areq)
+static int ecb_des3_ede_encrypt(struct skcipher_request *req)
 {
-    struct crypto_ablkcipher *cipher = crypto_ablkcipher_reqtfm(areq);
-    struct des_ctx *ctx = crypto_ablkcipher_ctx(cipher);
-
-    return lq_queue_mgr(ctx, areq, areq->info, CRYPTO_DIR_ENCRYPT, 0);
+        return lq_des_queue_mgr(req, CRYPTO_DIR_ENCRYPT, DES_MODE_ECB);
 }
 
-/* \fn static int lq_ecb_des_decrypt(struct ablkcipher_request *areq)
- * \ingroup IFX_DES_FUNCTIONS
- * \brief Decrypt function for DES algo
- * \param *areq Pointer to ablkcipher request in memory
- * \return 0 is success, -EINPROGRESS if encryting, EINVAL if failure
-*/
-static int lq_ecb_des_decrypt(struct ablkcipher_request *areq)
+static int ecb_des3_ede_decrypt(struct skcipher_request *req)
 {
-    struct crypto_ablkcipher *cipher = crypto_ablkcipher_reqtfm(areq);
-    struct des_ctx *ctx = crypto_ablkcipher_ctx(cipher);
-
-    return lq_queue_mgr(ctx, areq, areq->info, CRYPTO_DIR_DECRYPT, 0);
-
+        return lq_des_queue_mgr(req, CRYPTO_DIR_DECRYPT, DES_MODE_ECB);
 }
 
-/* \fn static int lq_cbc_ecb_des_encrypt(struct ablkcipher_request *areq)
- * \ingroup IFX_DES_FUNCTIONS
- * \brief Decrypt function for DES algo
- * \param *areq Pointer to ablkcipher request in memory
- * \return 0 is success, -EINPROGRESS if encryting, EINVAL if failure
-*/
-
-static int lq_cbc_des_encrypt(struct ablkcipher_request *areq)
+static int cbc_des3_ede_encrypt(struct skcipher_request *req)
 {
-    struct crypto_ablkcipher *cipher = crypto_ablkcipher_reqtfm(areq);
-    struct des_ctx *ctx = crypto_ablkcipher_ctx(cipher);
-
-    return lq_queue_mgr(ctx, areq, areq->info, CRYPTO_DIR_ENCRYPT, 1);
+        return lq_des_queue_mgr(req, CRYPTO_DIR_ENCRYPT, DES_MODE_CBC);
 }
-/* \fn static int lq_cbc_des_decrypt(struct ablkcipher_request *areq)
- * \ingroup IFX_DES_FUNCTIONS
- * \brief Decrypt function for DES algo
- * \param *areq Pointer to ablkcipher request in memory
- * \return 0 is success, -EINPROGRESS if encryting, EINVAL if failure
-*/
 
-static int lq_cbc_des_decrypt(struct ablkcipher_request *areq)
+static int cbc_des3_ede_decrypt(struct skcipher_request *req)
 {
-    struct crypto_ablkcipher *cipher = crypto_ablkcipher_reqtfm(areq);
-    struct des_ctx *ctx = crypto_ablkcipher_ctx(cipher);
-
-    return lq_queue_mgr(ctx, areq, areq->info, CRYPTO_DIR_DECRYPT, 1);
+        return lq_des_queue_mgr(req, CRYPTO_DIR_DECRYPT, DES_MODE_CBC);
 }
 
-struct lq_des_alg {
-    struct crypto_alg alg;
-};
-
-/* DES Supported algo array */
-static struct lq_des_alg des_drivers_alg [] = {
-    {
-        .alg = {
-            .cra_name        = "des",
-            .cra_driver_name = "lqdeu-des",
-            .cra_flags       = CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC, 
-            .cra_blocksize   = DES_BLOCK_SIZE,
-            .cra_ctxsize     = sizeof(struct des_ctx),
-            .cra_type        = &crypto_ablkcipher_type,
-            .cra_priority    = 300,
-            .cra_module      = THIS_MODULE,
-            .cra_ablkcipher  = {
-                                .setkey = lq_des_setkey,
-                                .encrypt = lq_des_encrypt,
-                                .decrypt = lq_des_decrypt,
-                                .geniv = "eseqiv",
-                                .min_keysize = DES_KEY_SIZE,
-                                .max_keysize = DES_KEY_SIZE,
-                                .ivsize = DES_BLOCK_SIZE,
-            }
-        }
-
-    },{
-        .alg = {
-            .cra_name        = "ecb(des)",
-            .cra_driver_name = "lqdeu-ecb(des)",
-            .cra_flags       = CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC, 
-            .cra_blocksize   = DES_BLOCK_SIZE,
-            .cra_ctxsize     = sizeof(struct des_ctx),
-            .cra_type        = &crypto_ablkcipher_type,
-            .cra_priority    = 400,
-            .cra_module      = THIS_MODULE,
-            .cra_ablkcipher  = {
-                                .setkey = lq_des_setkey,
-                                .encrypt = lq_ecb_des_encrypt,
-                                .decrypt = lq_ecb_des_decrypt,
-                                .geniv = "eseqiv",
-                                .min_keysize = DES_KEY_SIZE,
-                                .max_keysize = DES_KEY_SIZE,
-                                .ivsize = DES_BLOCK_SIZE,
-            }
-         }
-    },{
-        .alg = {
-            .cra_name        = "cbc(des)",
-            .cra_driver_name = "lqdeu-cbc(des)",
-            .cra_flags       = CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC, 
-            .cra_blocksize   = DES_BLOCK_SIZE,
-            .cra_ctxsize     = sizeof(struct des_ctx),
-            .cra_type        = &crypto_ablkcipher_type,
-            .cra_priority    = 400,
-            .cra_module      = THIS_MODULE,
-            .cra_ablkcipher  = {
-                                .setkey = lq_des_setkey,
-                                .encrypt = lq_cbc_des_encrypt,
-                                .decrypt = lq_cbc_des_decrypt,
-                                .geniv = "eseqiv",
-                                .min_keysize = DES3_EDE_KEY_SIZE,
-                                .max_keysize = DES3_EDE_KEY_SIZE,
-                                .ivsize = DES3_EDE_BLOCK_SIZE,
-            }
-         }
-    },{
-        .alg = {
-            .cra_name        = "des3_ede",
-            .cra_driver_name = "lqdeu-des3_ede",
-            .cra_flags       = CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC, 
-            .cra_blocksize   = DES_BLOCK_SIZE,
-            .cra_ctxsize     = sizeof(struct des_ctx),
-            .cra_type        = &crypto_ablkcipher_type,
-            .cra_priority    = 300,
-            .cra_module      = THIS_MODULE,
-            .cra_ablkcipher  = {
-                                .setkey = lq_des3_ede_setkey,
-                                .encrypt = lq_des_encrypt,
-                                .decrypt = lq_des_decrypt,
-                                .geniv = "eseqiv",
-                                .min_keysize = DES_KEY_SIZE,
-                                .max_keysize = DES_KEY_SIZE,
-                                .ivsize = DES_BLOCK_SIZE,
-            }
-         }
-    },{
-        .alg = {
-            .cra_name        = "ecb(des3_ede)",
-            .cra_driver_name = "lqdeu-ecb(des3_ede)",
-            .cra_flags       = CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC, 
-            .cra_blocksize   = DES_BLOCK_SIZE,
-            .cra_ctxsize     = sizeof(struct des_ctx),
-            .cra_type        = &crypto_ablkcipher_type,
-            .cra_priority    = 400,
-            .cra_module      = THIS_MODULE,
-            .cra_ablkcipher  = {
-                                .setkey = lq_des3_ede_setkey,
-                                .encrypt = lq_ecb_des_encrypt,
-                                .decrypt = lq_ecb_des_decrypt,
-                                .geniv = "eseqiv",
-                                .min_keysize = DES3_EDE_KEY_SIZE,
-                                .max_keysize = DES3_EDE_KEY_SIZE,
-                                .ivsize = DES3_EDE_BLOCK_SIZE,
-            }
-         } 
-    },{
-        .alg = {
-            .cra_name        = "cbc(des3_ede)",
-            .cra_driver_name = "lqdeu-cbc(des3_ede)",
-            .cra_flags       = CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC, 
-            .cra_blocksize   = DES_BLOCK_SIZE,
-            .cra_ctxsize     = sizeof(struct des_ctx),
-            .cra_type        = &crypto_ablkcipher_type,
-            .cra_priority    = 400,
-            .cra_module      = THIS_MODULE,
-            .cra_ablkcipher  = {
-                                .setkey = lq_des3_ede_setkey,
-                                .encrypt = lq_cbc_des_encrypt,
-                                .decrypt = lq_cbc_des_decrypt,
-                                .geniv = "eseqiv",
-                                .min_keysize = DES3_EDE_KEY_SIZE,
-                                .max_keysize = DES3_EDE_KEY_SIZE,
-                                .ivsize = DES3_EDE_BLOCK_SIZE,
-            }
-         }
-    } 
+/*
+ * \brief DES function mappings
+*/
+static struct skcipher_alg lq_deu_des_algs[] = {
+        {
+                .base = {
+                        .cra_name               = "ecb(des3_ede)",
+                        .cra_driver_name        = "ifxdeu-dma-ecb(des3_ede)",
+                        .cra_priority           = IFXDEU_ASYNC_PRIORITY,
+                        .cra_flags              = CRYPTO_ALG_ASYNC,
+                        .cra_blocksize          = DES3_EDE_BLOCK_SIZE,
+                        .cra_ctxsize            = sizeof(struct des_ctx),
+                        .cra_alignmask          = 3,
+                        .cra_module             = THIS_MODULE,
+                },
+                .min_keysize    = DES3_EDE_KEY_SIZE,
+                .max_keysize    = DES3_EDE_KEY_SIZE,
+                .setkey         = des3_ede_setkey,
+                .encrypt        = ecb_des3_ede_encrypt,
+                .decrypt        = ecb_des3_ede_decrypt,
+                .init           = des_init_tfm,
+        }, {
+                .base = {
+                        .cra_name               = "cbc(des3_ede)",
+                        .cra_driver_name        = "ifxdeu-dma-cbc(des3_ede)",
+                        .cra_priority           = IFXDEU_ASYNC_PRIORITY,
+                        .cra_flags              = CRYPTO_ALG_ASYNC,
+                        .cra_blocksize          = DES3_EDE_BLOCK_SIZE,
+                        .cra_ctxsize            = sizeof(struct des_ctx),
+                        .cra_alignmask          = 3,
+                        .cra_module             = THIS_MODULE,
+                },
+                .min_keysize    = DES3_EDE_KEY_SIZE,
+                .max_keysize    = DES3_EDE_KEY_SIZE,
+                .ivsize         = DES3_EDE_BLOCK_SIZE,
+                .setkey         = des3_ede_setkey,
+                .encrypt        = cbc_des3_ede_encrypt,
+                .decrypt        = cbc_des3_ede_decrypt,
+                .init           = des_init_tfm,
+        },
 };
 
 /*! \fn int __init lqdeu_async_des_init (void)
  *  \ingroup IFX_DES_FUNCTIONS
- *  \brief initialize des driver
+ *  \brief Initializes the DMA driven async. 3DES driver
+ *  \return 0 on success
 */
 int __init lqdeu_async_des_init (void)
 {
-    int i, j, ret = -EINVAL;
-
-#if (LINUX_VERSION_CODE < KERNEL_VERSION(2,6,20))
-     if (!disable_multiblock) {
-                ifxdeu_des_alg.cra_u.cipher.cia_max_nbytes = DES_BLOCK_SIZE;    //(size_t)-1;
-                ifxdeu_des_alg.cra_u.cipher.cia_req_align = 16;
-                ifxdeu_des_alg.cra_u.cipher.cia_ecb = ifx_deu_des_ecb;
-                ifxdeu_des_alg.cra_u.cipher.cia_cbc = ifx_deu_des_cbc;
-                ifxdeu_des_alg.cra_u.cipher.cia_cfb = ifx_deu_des_cfb;
-                ifxdeu_des_alg.cra_u.cipher.cia_ofb = ifx_deu_des_ofb;
+        int ret;
+
+        ret = crypto_register_skciphers(lq_deu_des_algs, ARRAY_SIZE(lq_deu_des_algs));
+        if (ret) {
+                printk(KERN_ERR "IFX DEU async DES initialization failed!\n");
+                return ret;
         }
-#endif
-     for (i = 0; i < ARRAY_SIZE(des_drivers_alg); i++) {
-         ret = crypto_register_alg(&des_drivers_alg[i].alg);
-	 //printk("driver: %s\n", des_drivers_alg[i].alg.cra_name);
-         if (ret)
-             goto des_err;
-     }
-            
-     des_chip_init();
-     CRTCL_SECT_INIT;
-
-
-    printk (KERN_NOTICE "IFX DEU DES initialized%s%s.\n", disable_multiblock ? "" : " (multiblock)", disable_deudma ? "" : " (DMA)");
-    return ret;
-
-des_err:
-     for (j = 0; j < i; j++) 
-        crypto_unregister_alg(&des_drivers_alg[i].alg);
-
-     printk(KERN_ERR "Lantiq %s driver initialization failed!\n", (char *)&des_drivers_alg[i].alg.cra_driver_name);
-     return ret;
-
-cbc_des3_ede_err:
-     for (i = 0; i < ARRAY_SIZE(des_drivers_alg); i++) {
-         if (!strcmp((char *)&des_drivers_alg[i].alg.cra_name, "cbc(des3_ede)"))
-             crypto_unregister_alg(&des_drivers_alg[i].alg);
-     }     
-
-     printk(KERN_ERR "Lantiq %s driver initialization failed!\n", (char *)&des_drivers_alg[i].alg.cra_driver_name);
-     return ret;
+
+        printk (KERN_NOTICE "IFX DEU DES initialized (async, DMA).\n");
+        return 0;
 }
 
 /*! \fn void __exit lqdeu_fini_async_des (void)
  *  \ingroup IFX_DES_FUNCTIONS
- *  \brief unregister des driver
+ *  \brief unregister the async. 3DES driver
 */
 void __exit lqdeu_fini_async_des (void)
 {
-    int i;
-    
-    for (i = 0; i < ARRAY_SIZE(des_drivers_alg); i++)
-        crypto_unregister_alg(&des_drivers_alg[i].alg);
-
-    des_queue->hw_status = DES_COMPLETED;
-    DEU_WAKEUP_EVENT(deu_dma_priv.deu_thread_wait, DES_ASYNC_EVENT,
-                                 deu_dma_priv.des_event_flags); 
-   
-    kfree(des_queue);
+        crypto_unregister_skciphers(lq_deu_des_algs, ARRAY_SIZE(lq_deu_des_algs));
 }
-
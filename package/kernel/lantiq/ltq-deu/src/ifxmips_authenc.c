@@ -0,0 +1,505 @@
+/******************************************************************************
+**
+** FILE NAME    : ifxmips_authenc.c
+** PROJECT      : IFX UEIP
+** MODULES      : DEU Module
+**
+** DESCRIPTION  : Data Encryption Unit Driver for combined HMAC-SHA1 and
+**                CBC cipher (IPsec ESP authenc)
+**
+**    This program is free software; you can redistribute it and/or modify
+**    it under the terms of the GNU General Public License as published by
+**    the Free Software Foundation; either version 2 of the License, or
+**    (at your option) any later version.
+**
+*******************************************************************************/
+/*!
+  \defgroup IFX_DEU IFX_DEU_DRIVERS
+  \ingroup API
+  \brief ifx deu driver module
+*/
+
+/*!
+  \file	ifxmips_authenc.c
+  \ingroup IFX_DEU
+  \brief authenc(hmac(sha1),cbc(...)) deu driver file
+*/
+
+/*!
+  \defgroup IFX_AUTHENC_FUNCTIONS IFX_AUTHENC_FUNCTIONS
+  \ingroup IFX_DEU
+  \brief ifx authenc functions
+*/
+
+/* Project header */
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/types.h>
+#include <linux/errno.h>
+#include <linux/crypto.h>
+#include <linux/scatterlist.h>
+#include <linux/spinlock.h>
+#include <crypto/aes.h>
+#include <crypto/des.h>
+#include <crypto/algapi.h>
+#include <crypto/authenc.h>
+#include <crypto/scatterwalk.h>
+#include <crypto/internal/aead.h>
+
+#include "ifxmips_deu.h"
+
+#if defined(CONFIG_AR9)
+#include "ifxmips_deu_ar9.h"
+#elif defined(CONFIG_VR9) || defined(CONFIG_AR10)
+#include "ifxmips_deu_vr9.h"
+#else
+#error "Plaform Unknwon!"
+#endif
+
+#define SHA1_DIGEST_SIZE        20
+#define SHA1_HMAC_BLOCK_SIZE    64
+#define SHA1_HMAC_MAX_KEYLEN    64
+#define HASH_START              IFX_HASH_CON
+
+/* the generic authenc template scores enc prio * 10 + auth prio */
+#define IFXDEU_AUTHENC_PRIORITY 6000
+
+extern spinlock_t sha1_hmac_lock;
+
+struct lq_authenc_ctx {
+    u32 authkey[SHA1_HMAC_MAX_KEYLEN / 4];
+    unsigned int authkeylen;
+    union {
+        struct aes_ctx aes;
+        struct des_ctx des;
+    } enc;
+};
+
+struct lq_authenc_alg {
+    struct aead_alg alg;
+    unsigned int blocksize;
+    int (*setkey)(struct lq_authenc_ctx *ctx, const u8 *key, unsigned int keylen);
+    void (*crypt)(struct lq_authenc_ctx *ctx, u8 *dst, const u8 *src,
+                  u8 *iv, unsigned int nbytes, int encdec);
+};
+
+/* partial hash block carried across scatterlist entries */
+struct lq_hmac_stream {
+    u32 buf[SHA1_HMAC_BLOCK_SIZE / 4];
+    unsigned int fill;
+};
+
+/*! \fn static void lq_hmac_start(struct lq_authenc_ctx *ctx, unsigned int len)
+ *  \ingroup IFX_AUTHENC_FUNCTIONS
+ *  \brief load the HMAC key and announce the number of blocks to the hash unit
+ *  \param ctx authenc context
+ *  \param len number of bytes that will be authenticated
+*/
+static void lq_hmac_start(struct lq_authenc_ctx *ctx, unsigned int len)
+{
+    volatile struct deu_hash_t *hash = (struct deu_hash_t *) HASH_START;
+    int i;
+
+    hash->KIDX |= 0x80000000; //reset keys back to 0
+    for (i = 0; i < ctx->authkeylen; i += 4) {
+        hash->KIDX = i / 4;
+        asm("sync");
+        hash->KEY = ctx->authkey[i / 4];
+    }
+
+    /* data, 0x80 pad byte and 64 bit length rounded up to full blocks */
+    hash->DBN = DIV_ROUND_UP(len + 9, SHA1_HMAC_BLOCK_SIZE);
+
+    //for vr9 change, ENDI = 1
+    *IFX_HASH_CON = HASH_CON_VALUE;
+
+    while (hash->controlr.BSY) {
+        // this will not take long
+    }
+}
+
+/*! \fn static void lq_hmac_block(const u32 *in)
+ *  \ingroup IFX_AUTHENC_FUNCTIONS
+ *  \brief feed one 64 byte block to the hash unit
+*/
+static void lq_hmac_block(const u32 *in)
+{
+    volatile struct deu_hash_t *hash = (struct deu_hash_t *) HASH_START;
+    int i;
+
+    for (i = 0; i < 16; i++)
+        hash->MR = in[i];
+
+    hash->controlr.GO = 1;
+    asm("sync");
+
+    while (hash->controlr.BSY) {
+        // this will not take long
+    }
+}
+
+/*! \fn static void lq_hmac_update(struct lq_hmac_stream *st, const u8 *data, unsigned int len)
+ *  \ingroup IFX_AUTHENC_FUNCTIONS
+ *  \brief feed data to the hash unit, buffering incomplete blocks
+*/
+static void lq_hmac_update(struct lq_hmac_stream *st, const u8 *data,
+                           unsigned int len)
+{
+    u8 *buf = (u8 *) st->buf;
+
+    if (st->fill) {
+        unsigned int n = min(SHA1_HMAC_BLOCK_SIZE - st->fill, len);
+
+        memcpy(buf + st->fill, data, n);
+        st->fill += n;
+        data += n;
+        len -= n;
+
+        if (st->fill < SHA1_HMAC_BLOCK_SIZE)
+            return;
+
+        lq_hmac_block(st->buf);
+        st->fill = 0;
+    }
+
+    for (; len >= SHA1_HMAC_BLOCK_SIZE; data += SHA1_HMAC_BLOCK_SIZE,
+                                        len -= SHA1_HMAC_BLOCK_SIZE) {
+        if ((unsigned long) data & 3) {
+            memcpy(buf, data, SHA1_HMAC_BLOCK_SIZE);
+            lq_hmac_block(st->buf);
+        } else {
+            lq_hmac_block((const u32 *) data);
+        }
+    }
+
+    memcpy(buf, data, len);
+    st->fill = len;
+}
+
+/*! \fn static void lq_hmac_final(struct lq_hmac_stream *st, unsigned int len, u32 *out)
+ *  \ingroup IFX_AUTHENC_FUNCTIONS
+ *  \brief pad the stream, wait for the digest and read it back
+ *  \param st hash stream
+ *  \param len number of bytes authenticated
+ *  \param out 20 byte digest
+*/
+static void lq_hmac_final(struct lq_hmac_stream *st, unsigned int len, u32 *out)
+{
+    volatile struct deu_hash_t *hash = (struct deu_hash_t *) HASH_START;
+    static const u8 padding[SHA1_HMAC_BLOCK_SIZE] = { 0x80, };
+    __be64 bits = cpu_to_be64(((u64) len << 3) + 512); // include the IPAD block
+    unsigned int padlen;
+
+    padlen = (st->fill < 56) ? (56 - st->fill) : ((64 + 56) - st->fill);
+    lq_hmac_update(st, padding, padlen);
+    lq_hmac_update(st, (const u8 *) &bits, sizeof(bits));
+
+    //wait for digest ready
+    while (!hash->controlr.DGRY) {
+        // this will not take long
+    }
+
+    out[0] = hash->D1R;
+    out[1] = hash->D2R;
+    out[2] = hash->D3R;
+    out[3] = hash->D4R;
+    out[4] = hash->D5R;
+}
+
+/*! \fn static void lq_authenc_hash_assoc(struct aead_request *req, struct lq_hmac_stream *st)
+ *  \ingroup IFX_AUTHENC_FUNCTIONS
+ *  \brief authenticate the associated data and copy it to dst for out-of-place requests
+*/
+static void lq_authenc_hash_assoc(struct aead_request *req,
+                                  struct lq_hmac_stream *st)
+{
+    struct scatter_walk walk;
+    unsigned int done = 0, n;
+    u8 *vaddr;
+
+    scatterwalk_start(&walk, req->src);
+
+    while (done < req->assoclen) {
+        n = scatterwalk_clamp(&walk, req->assoclen - done);
+        vaddr = scatterwalk_map(&walk);
+
+        lq_hmac_update(st, vaddr, n);
+        if (req->src != req->dst)
+            scatterwalk_map_and_copy(vaddr, req->dst, done, n, 1);
+
+        scatterwalk_unmap(vaddr);
+        scatterwalk_advance(&walk, n);
+        done += n;
+        scatterwalk_done(&walk, 0, req->assoclen - done);
+    }
+}
+
+/*! \fn static int lq_authenc_crypt(struct aead_request *req, int encdec)
+ *  \ingroup IFX_AUTHENC_FUNCTIONS
+ *  \brief encrypt-then-MAC / MAC-then-decrypt in a single walk over the scatterlists
+ *  \param req aead request
+ *  \param encdec 1 for encrypt; 0 for decrypt
+ *  \return 0, -EINVAL for bad lengths or -EBADMSG on ICV mismatch
+*/
+static int lq_authenc_crypt(struct aead_request *req, int encdec)
+{
+    struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+    struct lq_authenc_ctx *ctx = crypto_aead_ctx(tfm);
+    struct lq_authenc_alg *lalg = container_of(crypto_aead_alg(tfm),
+                                               struct lq_authenc_alg, alg);
+    unsigned int authsize = crypto_aead_authsize(tfm);
+    unsigned int bs = lalg->blocksize;
+    unsigned int cryptlen, remain;
+    struct scatterlist src_sg[2], dst_sg[2];
+    struct scatter_walk in, out;
+    struct lq_hmac_stream st;
+    u32 iv[AES_BLOCK_SIZE / 4];
+    u32 block[AES_BLOCK_SIZE / 4];
+    u32 digest[SHA1_DIGEST_SIZE / 4];
+    u8 icv[SHA1_DIGEST_SIZE];
+    unsigned long flag;
+
+    if (!encdec && req->cryptlen < authsize)
+        return -EINVAL;
+
+    cryptlen = req->cryptlen - (encdec ? 0 : authsize);
+    if (cryptlen % bs)
+        return -EINVAL;
+
+    memcpy(iv, req->iv, bs);
+    st.fill = 0;
+
+    spin_lock_irqsave(&sha1_hmac_lock, flag);
+
+    lq_hmac_start(ctx, req->assoclen + cryptlen);
+    lq_authenc_hash_assoc(req, &st);
+
+    scatterwalk_start(&in, scatterwalk_ffwd(src_sg, req->src, req->assoclen));
+    scatterwalk_start(&out, scatterwalk_ffwd(dst_sg, req->dst, req->assoclen));
+
+    for (remain = cryptlen; remain; ) {
+        unsigned int n = min(scatterwalk_clamp(&in, remain),
+                             scatterwalk_clamp(&out, remain));
+
+        if (((in.offset | out.offset) & 3) == 0)
+            n &= ~(bs - 1);
+        else
+            n = 0;
+
+        if (n) {
+            u8 *src = scatterwalk_map(&in);
+            u8 *dst = scatterwalk_map(&out);
+
+            /* the chunk is hot in the cache for both units */
+            if (encdec) {
+                lalg->crypt(ctx, dst, src, (u8 *) iv, n, encdec);
+                lq_hmac_update(&st, dst, n);
+            } else {
+                lq_hmac_update(&st, src, n);
+                lalg->crypt(ctx, dst, src, (u8 *) iv, n, encdec);
+            }
+
+            scatterwalk_unmap(dst);
+            scatterwalk_unmap(src);
+            scatterwalk_advance(&in, n);
+            scatterwalk_advance(&out, n);
+        } else {
+            /* block straddles an sg entry or is unaligned */
+            n = bs;
+            scatterwalk_copychunks(block, &in, n, 0);
+            if (encdec) {
+                lalg->crypt(ctx, (u8 *) block, (u8 *) block, (u8 *) iv, n, encdec);
+                lq_hmac_update(&st, (u8 *) block, n);
+            } else {
+                lq_hmac_update(&st, (u8 *) block, n);
+                lalg->crypt(ctx, (u8 *) block, (u8 *) block, (u8 *) iv, n, encdec);
+            }
+            scatterwalk_copychunks(block, &out, n, 1);
+        }
+
+        remain -= n;
+        scatterwalk_done(&in, 0, remain);
+        scatterwalk_done(&out, 1, remain);
+    }
+
+    lq_hmac_final(&st, req->assoclen + cryptlen, digest);
+
+    spin_unlock_irqrestore(&sha1_hmac_lock, flag);
+
+    if (encdec) {
+        scatterwalk_map_and_copy(digest, req->dst, req->assoclen + cryptlen,
+                                 authsize, 1);
+        return 0;
+    }
+
+    scatterwalk_map_and_copy(icv, req->src, req->assoclen + cryptlen,
+                             authsize, 0);
+
+    return crypto_memneq(digest, icv, authsize) ? -EBADMSG : 0;
+}
+
+static int lq_authenc_encrypt(struct aead_request *req)
+{
+    return lq_authenc_crypt(req, CRYPTO_DIR_ENCRYPT);
+}
+
+static int lq_authenc_decrypt(struct aead_request *req)
+{
+    return lq_authenc_crypt(req, CRYPTO_DIR_DECRYPT);
+}
+
+/*! \fn static int lq_authenc_setkey(struct crypto_aead *tfm, const u8 *key, unsigned int keylen)
+ *  \ingroup IFX_AUTHENC_FUNCTIONS
+ *  \brief split the rtattr encoded authenc key into HMAC and cipher key
+ *  \return -EINVAL - bad key, 0 - SUCCESS
+*/
+static int lq_authenc_setkey(struct crypto_aead *tfm, const u8 *key,
+                             unsigned int keylen)
+{
+    struct lq_authenc_ctx *ctx = crypto_aead_ctx(tfm);
+    struct lq_authenc_alg *lalg = container_of(crypto_aead_alg(tfm),
+                                               struct lq_authenc_alg, alg);
+    struct crypto_authenc_keys keys;
+
+    if (crypto_authenc_extractkeys(&keys, key, keylen))
+        goto badkey;
+
+    /* the hash unit only takes keys up to one block */
+    if (keys.authkeylen > SHA1_HMAC_MAX_KEYLEN)
+        goto badkey;
+
+    memset(ctx->authkey, 0, sizeof(ctx->authkey));
+    memcpy(ctx->authkey, keys.authkey, keys.authkeylen);
+    ctx->authkeylen = keys.authkeylen;
+
+    if (lalg->setkey(ctx, keys.enckey, keys.enckeylen))
+        goto badkey;
+
+    return 0;
+
+badkey:
+    crypto_aead_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN);
+    return -EINVAL;
+}
+
+static int lq_authenc_aes_setkey(struct lq_authenc_ctx *ctx, const u8 *key,
+                                 unsigned int keylen)
+{
+    if (keylen != 16 && keylen != 24 && keylen != 32)
+        return -EINVAL;
+
+    ctx->enc.aes.key_length = keylen;
+    memcpy(ctx->enc.aes.buf, key, keylen);
+
+    return 0;
+}
+
+static void lq_authenc_aes_crypt(struct lq_authenc_ctx *ctx, u8 *dst,
+                                 const u8 *src, u8 *iv, unsigned int nbytes,
+                                 int encdec)
+{
+    ifx_deu_aes(&ctx->enc.aes, dst, src, iv, nbytes, encdec, 1);
+}
+
+static int lq_authenc_des3_setkey(struct lq_authenc_ctx *ctx, const u8 *key,
+                                  unsigned int keylen)
+{
+    if (keylen != DES3_EDE_KEY_SIZE)
+        return -EINVAL;
+
+    ctx->enc.des.controlr_M = keylen / 8 + 1;      // 3DES EDE1 / EDE2 / EDE3 Mode
+    ctx->enc.des.key_length = keylen;
+    memcpy(ctx->enc.des.expkey, key, keylen);
+
+    return 0;
+}
+
+static void lq_authenc_des3_crypt(struct lq_authenc_ctx *ctx, u8 *dst,
+                                  const u8 *src, u8 *iv, unsigned int nbytes,
+                                  int encdec)
+{
+    ifx_deu_des(&ctx->enc.des, dst, src, iv, nbytes, encdec, 1);
+}
+
+/*
+ * \brief authenc function mappings
+*/
+static struct lq_authenc_alg lq_authenc_algs[] = {
+    {
+        .alg = {
+            .base = {
+                .cra_name           = "authenc(hmac(sha1),cbc(aes))",
+                .cra_driver_name    = "ifxdeu-authenc-hmac-sha1-cbc-aes",
+                .cra_priority       = IFXDEU_AUTHENC_PRIORITY,
+                .cra_blocksize      = AES_BLOCK_SIZE,
+                .cra_ctxsize        = sizeof(struct lq_authenc_ctx),
+                .cra_alignmask      = 3,
+                .cra_module         = THIS_MODULE,
+            },
+            .ivsize         = AES_BLOCK_SIZE,
+            .maxauthsize    = SHA1_DIGEST_SIZE,
+            .setkey         = lq_authenc_setkey,
+            .encrypt        = lq_authenc_encrypt,
+            .decrypt        = lq_authenc_decrypt,
+        },
+        .blocksize  = AES_BLOCK_SIZE,
+        .setkey     = lq_authenc_aes_setkey,
+        .crypt      = lq_authenc_aes_crypt,
+    }, {
+        .alg = {
+            .base = {
+                .cra_name           = "authenc(hmac(sha1),cbc(des3_ede))",
+                .cra_driver_name    = "ifxdeu-authenc-hmac-sha1-cbc-des3_ede",
+                .cra_priority       = IFXDEU_AUTHENC_PRIORITY,
+                .cra_blocksize      = DES3_EDE_BLOCK_SIZE,
+                .cra_ctxsize        = sizeof(struct lq_authenc_ctx),
+                .cra_alignmask      = 3,
+                .cra_module         = THIS_MODULE,
+            },
+            .ivsize         = DES3_EDE_BLOCK_SIZE,
+            .maxauthsize    = SHA1_DIGEST_SIZE,
+            .setkey         = lq_authenc_setkey,
+            .encrypt        = lq_authenc_encrypt,
+            .decrypt        = lq_authenc_decrypt,
+        },
+        .blocksize  = DES3_EDE_BLOCK_SIZE,
+        .setkey     = lq_authenc_des3_setkey,
+        .crypt      = lq_authenc_des3_crypt,
+    },
+};
+
+/*! \fn int __init ifxdeu_init_authenc (void)
+ *  \ingroup IFX_AUTHENC_FUNCTIONS
+ *  \brief register the combined authenc algorithms
+*/
+int __init ifxdeu_init_authenc (void)
+{
+    int i, ret;
+
+    for (i = 0; i < ARRAY_SIZE(lq_authenc_algs); i++) {
+        ret = crypto_register_aead(&lq_authenc_algs[i].alg);
+        if (ret)
+            goto authenc_err;
+    }
+
+    printk (KERN_NOTICE "IFX DEU AUTHENC initialized.\n");
+    return 0;
+
+authenc_err:
+    while (i--)
+        crypto_unregister_aead(&lq_authenc_algs[i].alg);
+    printk (KERN_ERR "IFX DEU AUTHENC initialization failed!\n");
+    return ret;
+}
+
+/*! \fn void __exit ifxdeu_fini_authenc (void)
+ *  \ingroup IFX_AUTHENC_FUNCTIONS
+ *  \brief unregister the combined authenc algorithms
+*/
+void __exit ifxdeu_fini_authenc (void)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(lq_authenc_algs); i++)
+        crypto_unregister_aead(&lq_authenc_algs[i].alg);
+}
@@ -84,12 +84,6 @@ extern char debug_level;
 #define DPRINTF(level, format, args...)
 #endif
 #define DES_3DES_START  IFX_DES_CON
-#define DES_KEY_SIZE            8
-#define DES_EXPKEY_WORDS        32
-#define DES_BLOCK_SIZE          8
-#define DES3_EDE_KEY_SIZE       (3 * DES_KEY_SIZE)
-#define DES3_EDE_EXPKEY_WORDS   (3 * DES_EXPKEY_WORDS)
-#define DES3_EDE_BLOCK_SIZE     DES_BLOCK_SIZE
 
 /* Function Declaration to prevent warning messages */
 void des_chip_init (void);
@@ -102,16 +96,6 @@ u32* memory_alignment(const u8 *arg, u32 *buff_alloc, int in_out, int nbytes);
 void aes_dma_memory_copy(u32 *outcopy, u32 *out_dma, u8 *out_arg, int nbytes);
 void des_dma_memory_copy(u32 *outcopy, u32 *out_dma, u8 *out_arg, int nbytes);
 
-void ifx_deu_des (void *ctx_arg, u8 *out_arg, const u8 *in_arg,
-             u8 *iv_arg, u32 nbytes, int encdec, int mode);
-
-struct des_ctx {
-        int controlr_M;
-        int key_length;
-        u8 iv[DES_BLOCK_SIZE];
-        u32 expkey[DES3_EDE_EXPKEY_WORDS];
-};
-
 extern int disable_multiblock;
 extern int disable_deudma;
 
@@ -163,6 +147,9 @@ void ifx_deu_des (void *ctx_arg, u8 *out_arg, const u8 *in_arg,
         int nblocks = 0;
         
         CRTCL_SECT_START;
+#ifdef CONFIG_CRYPTO_DEV_DMA
+        deu_dma_wait_idle();
+#endif
 
         des->controlr.M = dctx->controlr_M;
         if (dctx->controlr_M == 0)      // des
@@ -55,6 +55,9 @@
 #include <linux/fs.h>       /* Stuff about file systems that we need */
 #include <asm/byteorder.h>
 #include "ifxmips_deu.h"
+#if defined(CONFIG_CRYPTO_DEV_DMA)
+#include "ifxmips_deu_dma.h"
+#endif
 
 #include <lantiq_soc.h>
 
@@ -68,7 +71,14 @@
 #error "Platform unknown!"
 #endif /* CONFIG_xxxx */
 
+#if defined(CONFIG_CRYPTO_DEV_DMA)
+int disable_deudma = 0;
+#else
 int disable_deudma = 1;
+#endif
+module_param(disable_deudma, int, 0);
+MODULE_PARM_DESC (disable_deudma,
+          "Do not register the DMA driven asynchronous algorithms.");
 
 void chip_version(void);
 
@@ -128,6 +138,28 @@ static int ltq_deu_probe(struct platform_device *pdev)
         printk (KERN_ERR "IFX MD5_HMAC initialization failed!\n");
     }
 #endif
+#if defined(CONFIG_CRYPTO_DEV_AUTHENC)
+    if ((ret = ifxdeu_init_authenc ())) {
+        printk (KERN_ERR "IFX AUTHENC initialization failed!\n");
+    }
+#endif
+#if defined(CONFIG_CRYPTO_DEV_DMA)
+    if (!disable_deudma) {
+        if ((ret = deu_dma_init (&pdev->dev))) {
+            printk (KERN_ERR "IFX DEU DMA initialization failed!\n");
+            disable_deudma = 1;
+        }
+    }
+    if (!disable_deudma) {
+        if ((ret = lqdeu_async_aes_init ())) {
+            printk (KERN_ERR "IFX async AES initialization failed!\n");
+        }
+        if ((ret = lqdeu_async_des_init ())) {
+            printk (KERN_ERR "IFX async DES initialization failed!\n");
+        }
+        deu_dma_speed_test ();
+    }
+#endif
 
 
 
@@ -142,6 +174,13 @@ static int ltq_deu_probe(struct platform_device *pdev)
 static int ltq_deu_remove(struct platform_device *pdev)
 {
 //#ifdef CONFIG_CRYPTO_DEV_PWR_SAVE_MODE
+    #if defined(CONFIG_CRYPTO_DEV_DMA)
+    if (!disable_deudma) {
+        lqdeu_fini_async_aes ();
+        lqdeu_fini_async_des ();
+        ifxdeu_fini_dma ();
+    }
+    #endif
     #if defined(CONFIG_CRYPTO_DEV_DES)
     ifxdeu_fini_des ();
     #endif
@@ -163,6 +202,9 @@ static int ltq_deu_remove(struct platform_device *pdev)
     #if defined(CONFIG_CRYPTO_DEV_MD5_HMAC)
     ifxdeu_fini_md5_hmac ();
     #endif
+    #if defined(CONFIG_CRYPTO_DEV_AUTHENC)
+    ifxdeu_fini_authenc ();
+    #endif
     printk("DEU has exited successfully\n");
 
 	return 0;
@@ -37,6 +37,9 @@
 #define IFXMIPS_DEU_H
 
 #include <crypto/algapi.h>
+#include <crypto/aes.h>
+#include <crypto/des.h>
+#include <crypto/ctr.h>
 #include <linux/interrupt.h>
 
 #define IFXDEU_ALIGNMENT 16
@@ -46,12 +49,14 @@
 #define IFX_DES_CON                             ((volatile u32 *)(IFX_DEU_BASE_ADDR + 0x0010))
 #define IFX_AES_CON                             ((volatile u32 *)(IFX_DEU_BASE_ADDR + 0x0050))
 #define IFX_HASH_CON                            ((volatile u32 *)(IFX_DEU_BASE_ADDR + 0x00B0))
+#define IFX_DEU_DMA_CON                         ((volatile u32 *)(IFX_DEU_BASE_ADDR + 0x00EC))
 #define IFX_ARC4_CON                            ((volatile u32 *)(IFX_DEU_BASE_ADDR + 0x0100))
 
 #define PFX	"ifxdeu: "
 #define CLC_START IFX_DEU_CLK
 #define IFXDEU_CRA_PRIORITY	300
 #define IFXDEU_COMPOSITE_PRIORITY 400
+#define IFXDEU_ASYNC_PRIORITY 500
 //#define KSEG1                         0xA0000000
 #define IFX_PMU_ENABLE 1
 #define IFX_PMU_DISABLE 0
@@ -71,6 +76,21 @@
 #define PROCESS_SCATTER 1
 #define PROCESS_NEW_PACKET 2
 
+/* transform contexts of the AES and DES units, the PIO routines
+   ifx_deu_aes() and ifx_deu_des() are called with either of them */
+struct aes_ctx {
+    int key_length;
+    u32 buf[AES_MAX_KEY_SIZE];
+    u8 nonce[CTR_RFC3686_NONCE_SIZE];
+};
+
+struct des_ctx {
+    int controlr_M;
+    int key_length;
+    u8 iv[DES_BLOCK_SIZE];
+    u32 expkey[DES3_EDE_EXPKEY_WORDS];
+};
+
 #define PMU_DEU BIT(20)
 #define START_DEU_POWER        \
     do {                       \
@@ -115,6 +135,7 @@ int __init ifxdeu_init_sha1 (void);
 int __init ifxdeu_init_md5 (void);
 int __init ifxdeu_init_sha1_hmac (void);
 int __init ifxdeu_init_md5_hmac (void);
+int __init ifxdeu_init_authenc (void);
 int __init lqdeu_async_aes_init(void);
 int __init lqdeu_async_des_init(void);
 
@@ -125,11 +146,17 @@ void __exit ifxdeu_fini_sha1 (void);
 void __exit ifxdeu_fini_md5 (void);
 void __exit ifxdeu_fini_sha1_hmac (void);
 void __exit ifxdeu_fini_md5_hmac (void);
+void __exit ifxdeu_fini_authenc (void);
 void __exit ifxdeu_fini_dma(void);
 void __exit lqdeu_fini_async_aes(void);
 void __exit lqdeu_fini_async_des(void);
 void __exit deu_fini (void);
-int deu_dma_init (void);
+int deu_dma_init (struct device *dev);
+void deu_dma_wait_idle (void);
+void ifx_deu_aes (void *ctx_arg, u8 *out_arg, const u8 *in_arg,
+        u8 *iv_arg, size_t nbytes, int encdec, int mode);
+void ifx_deu_des (void *ctx_arg, u8 *out_arg, const u8 *in_arg,
+        u8 *iv_arg, u32 nbytes, int encdec, int mode);
 
 
 
@@ -39,4 +39,648 @@
 */
 
 /* Project header files */ 
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/types.h>
+#include <linux/errno.h>
+#include <linux/slab.h>
+#include <linux/interrupt.h>
+#include <linux/dma-mapping.h>
+#include <linux/completion.h>
+#include <linux/jiffies.h>
+#include <crypto/scatterwalk.h>
+#include <crypto/internal/skcipher.h>
 
+#include <lantiq_soc.h>
+#include <xway_dma.h>
+
+#include "ifxmips_deu.h"
+#include "ifxmips_deu_dma.h"
+
+#if defined(CONFIG_DANUBE)
+#include "ifxmips_deu_danube.h"
+#elif defined(CONFIG_AR9)
+#include "ifxmips_deu_ar9.h"
+#elif defined(CONFIG_VR9) || defined(CONFIG_AR10)
+#include "ifxmips_deu_vr9.h"
+#else
+#error "Platform unknown!"
+#endif
+
+#define DEU_DMA_IRQ             (INT_NUM_IM2_IRL0 + DEU_DMA_RX_CHAN)
+
+extern spinlock_t aes_lock;
+extern spinlock_t des_lock;
+
+static struct {
+    struct device *dev;
+    struct ltq_dma_channel rx;
+    struct ltq_dma_channel tx;
+    struct crypto_queue queue;
+    spinlock_t lock;                /* protects queue and busy */
+    struct tasklet_struct done_task;
+    int busy;                       /* a request is owned by the engine */
+
+    /* request currently handed to the hardware */
+    struct skcipher_request *cur;
+    int active;
+    int last_rx;
+    struct scatterlist *src;
+    struct scatterlist *dst;
+    int src_nents;
+    int dst_nents;
+    int src_mapped;
+    int dst_mapped;
+    struct scatterlist bounce_sg;
+    u8 *bounce;
+    unsigned int len;
+} deu_dma;
+
+/*! \fn static int deu_dma_sg_ok(struct scatterlist *sg, unsigned int nbytes)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief check whether a scatterlist can be handed to the DMA without copying
+ *  \param sg scatterlist to check
+ *  \param nbytes number of bytes used from the scatterlist
+ *  \return number of entries, 0 if the list has to be bounced
+*/
+static int deu_dma_sg_ok(struct scatterlist *sg, unsigned int nbytes)
+{
+    int nents = 0;
+
+    while (sg && nbytes) {
+        unsigned int len = min(sg->length, nbytes);
+
+        if ((sg->offset & 3) || (len & 3) || len > LTQ_DMA_SIZE_MASK)
+            return 0;
+        if (++nents > DEU_DMA_MAX_SEGS)
+            return 0;
+
+        nbytes -= len;
+        sg = sg_next(sg);
+    }
+
+    return nbytes ? 0 : nents;
+}
+
+/*! \fn static void deu_dma_post(struct ltq_dma_channel *ch, struct scatterlist *sg, int nents, unsigned int nbytes, int rx)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief fill one descriptor per mapped scatterlist entry, the first descriptor is handed over last
+ *  \param ch DMA channel
+ *  \param sg mapped scatterlist
+ *  \param nents number of mapped entries
+ *  \param nbytes number of bytes to transfer
+ *  \param rx 1 for the receive (DEU -> memory) channel
+ *  \return index of the last descriptor used
+*/
+static int deu_dma_post(struct ltq_dma_channel *ch, struct scatterlist *sg,
+                        int nents, unsigned int nbytes, int rx)
+{
+    struct ltq_dma_desc *first = &ch->desc_base[ch->desc];
+    struct scatterlist *s;
+    int i, last = ch->desc;
+
+    for_each_sg(sg, s, nents, i) {
+        struct ltq_dma_desc *desc = &ch->desc_base[ch->desc];
+        dma_addr_t addr = sg_dma_address(s);
+        unsigned int len = min(sg_dma_len(s), nbytes);
+        u32 ctl = len & LTQ_DMA_SIZE_MASK;
+
+        if (rx) {
+            desc->addr = addr & ~7;
+            ctl |= LTQ_DMA_RX_OFFSET(addr & 7);
+        } else {
+            desc->addr = addr & ~15;
+            ctl |= LTQ_DMA_TX_OFFSET(addr & 15);
+            if (i == 0)
+                ctl |= LTQ_DMA_SOP;
+            if (i == nents - 1)
+                ctl |= LTQ_DMA_EOP;
+        }
+        if (i)
+            ctl |= LTQ_DMA_OWN;
+        desc->ctl = ctl;
+
+        nbytes -= len;
+        last = ch->desc;
+        ch->desc = (ch->desc + 1) % LTQ_DESC_NUM;
+    }
+
+    wmb();
+    first->ctl |= LTQ_DMA_OWN;
+
+    return last;
+}
+
+/*! \fn static int deu_dma_map(void)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief map the scatterlists of the current request for the DEU
+ *  \return 0 on success, -ENOMEM if a list could not be mapped
+*/
+static int deu_dma_map(void)
+{
+    if (deu_dma.src == deu_dma.dst) {
+        deu_dma.src_mapped = dma_map_sg(deu_dma.dev, deu_dma.src,
+                                        deu_dma.src_nents, DMA_BIDIRECTIONAL);
+        deu_dma.dst_mapped = deu_dma.src_mapped;
+        return deu_dma.src_mapped ? 0 : -ENOMEM;
+    }
+
+    deu_dma.src_mapped = dma_map_sg(deu_dma.dev, deu_dma.src,
+                                    deu_dma.src_nents, DMA_TO_DEVICE);
+    if (!deu_dma.src_mapped)
+        return -ENOMEM;
+
+    deu_dma.dst_mapped = dma_map_sg(deu_dma.dev, deu_dma.dst,
+                                    deu_dma.dst_nents, DMA_FROM_DEVICE);
+    if (!deu_dma.dst_mapped) {
+        dma_unmap_sg(deu_dma.dev, deu_dma.src, deu_dma.src_nents, DMA_TO_DEVICE);
+        return -ENOMEM;
+    }
+
+    return 0;
+}
+
+/*! \fn static int deu_dma_pio(struct skcipher_request *req, unsigned int len)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief process a request that could not be mapped with the PIO routine of its unit
+ *  \param req skcipher request
+ *  \param len request length padded to the block size
+ *  \return 1 when the request is complete, -ENOMEM otherwise
+*/
+static int deu_dma_pio(struct skcipher_request *req, unsigned int len)
+{
+    struct deu_dma_reqctx *rctx = skcipher_request_ctx(req);
+    u8 iv[16];
+    u8 *buf;
+
+    buf = kzalloc(len, GFP_ATOMIC);
+    if (!buf)
+        return -ENOMEM;
+
+    /* the done hook updates req->iv, so the PIO routine works on a copy */
+    if (req->iv)
+        memcpy(iv, req->iv, rctx->ops->blocksize);
+
+    scatterwalk_map_and_copy(buf, req->src, 0, req->cryptlen, 0);
+    rctx->ops->pio(req, buf, len, iv);
+    scatterwalk_map_and_copy(buf, req->dst, 0, req->cryptlen, 1);
+    kzfree(buf);
+
+    return 1;
+}
+
+/*! \fn static int deu_dma_start(struct skcipher_request *req)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief map a request and hand it to the DEU, completion is signalled by the rx interrupt
+ *  \param req skcipher request
+ *  \return 0 if the hardware was started, 1 if the request was completed
+ *           by the PIO fallback, negative error code otherwise
+*/
+static int deu_dma_start(struct skcipher_request *req)
+{
+    volatile struct deu_dma_t *dma = (struct deu_dma_t *) IFX_DEU_DMA_CON;
+    struct deu_dma_reqctx *rctx = skcipher_request_ctx(req);
+    const struct deu_dma_ops *ops = rctx->ops;
+    unsigned int len = ALIGN(req->cryptlen, ops->blocksize);
+    int src_nents = 0, dst_nents = 0;
+    unsigned long flag;
+
+    deu_dma.bounce = NULL;
+    if (len == req->cryptlen) {
+        src_nents = deu_dma_sg_ok(req->src, len);
+        dst_nents = deu_dma_sg_ok(req->dst, len);
+    }
+
+    if (!src_nents || !dst_nents) {
+        /* unaligned, fragmented or padded: run it through a linear buffer */
+        deu_dma.bounce = kzalloc(len, GFP_ATOMIC | GFP_DMA);
+        if (!deu_dma.bounce)
+            return -ENOMEM;
+        scatterwalk_map_and_copy(deu_dma.bounce, req->src, 0, req->cryptlen, 0);
+        sg_init_one(&deu_dma.bounce_sg, deu_dma.bounce, len);
+        deu_dma.src = deu_dma.dst = &deu_dma.bounce_sg;
+        src_nents = dst_nents = 1;
+    } else {
+        deu_dma.src = req->src;
+        deu_dma.dst = req->dst;
+    }
+
+    deu_dma.src_nents = src_nents;
+    deu_dma.dst_nents = dst_nents;
+    if (deu_dma_map()) {
+        kzfree(deu_dma.bounce);
+        deu_dma.bounce = NULL;
+        return deu_dma_pio(req, len);
+    }
+    deu_dma.len = len;
+    deu_dma.cur = req;
+
+    /* keep the PIO paths of both units out while the DMA owns the DEU */
+    spin_lock_irqsave(&aes_lock, flag);
+    spin_lock(&des_lock);
+
+    ops->setup(req);
+
+    dma->controlr.ALGO = ops->algo;
+    dma->controlr.BS = 0;
+    dma->controlr.EN = 1;
+
+    deu_dma.last_rx = deu_dma_post(&deu_dma.rx, deu_dma.dst,
+                                   deu_dma.dst_mapped, len, 1);
+    deu_dma.active = 1;
+    deu_dma_post(&deu_dma.tx, deu_dma.src, deu_dma.src_mapped, len, 0);
+
+    spin_unlock(&des_lock);
+    spin_unlock_irqrestore(&aes_lock, flag);
+
+    return 0;
+}
+
+/*! \fn static void deu_dma_unmap(void)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief release the mappings of the finished request and copy out a bounced result
+*/
+static void deu_dma_unmap(void)
+{
+    struct skcipher_request *req = deu_dma.cur;
+
+    if (deu_dma.src == deu_dma.dst) {
+        dma_unmap_sg(deu_dma.dev, deu_dma.src, deu_dma.src_nents, DMA_BIDIRECTIONAL);
+    } else {
+        dma_unmap_sg(deu_dma.dev, deu_dma.src, deu_dma.src_nents, DMA_TO_DEVICE);
+        dma_unmap_sg(deu_dma.dev, deu_dma.dst, deu_dma.dst_nents, DMA_FROM_DEVICE);
+    }
+
+    if (deu_dma.bounce) {
+        scatterwalk_map_and_copy(deu_dma.bounce, req->dst, 0, req->cryptlen, 1);
+        kzfree(deu_dma.bounce);
+        deu_dma.bounce = NULL;
+    }
+}
+
+/*! \fn static void deu_dma_clean_ring(struct ltq_dma_channel *ch, int nents)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief clear the descriptors used by the finished request
+*/
+static void deu_dma_clean_ring(struct ltq_dma_channel *ch, int nents)
+{
+    int i = (ch->desc + LTQ_DESC_NUM - nents) % LTQ_DESC_NUM;
+
+    while (nents--) {
+        memset(&ch->desc_base[i], 0, sizeof(struct ltq_dma_desc));
+        i = (i + 1) % LTQ_DESC_NUM;
+    }
+}
+
+/*! \fn static void deu_dma_finish(struct skcipher_request *req, int err)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief report a request back to the crypto API
+*/
+static void deu_dma_finish(struct skcipher_request *req, int err)
+{
+    struct deu_dma_reqctx *rctx = skcipher_request_ctx(req);
+
+    if (!err && rctx->ops->done)
+        rctx->ops->done(req);
+
+    req->base.complete(&req->base, err);
+}
+
+/*! \fn static void deu_dma_next(void)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief dequeue requests until one is running on the hardware or the queue is empty
+*/
+static void deu_dma_next(void)
+{
+    struct crypto_async_request *async, *backlog;
+    unsigned long flag;
+    int err;
+
+    do {
+        spin_lock_irqsave(&deu_dma.lock, flag);
+        backlog = crypto_get_backlog(&deu_dma.queue);
+        async = crypto_dequeue_request(&deu_dma.queue);
+        if (!async)
+            deu_dma.busy = 0;
+        spin_unlock_irqrestore(&deu_dma.lock, flag);
+
+        if (!async)
+            return;
+
+        if (backlog)
+            backlog->complete(backlog, -EINPROGRESS);
+
+        err = deu_dma_start(skcipher_request_cast(async));
+        if (err)
+            deu_dma_finish(skcipher_request_cast(async), err < 0 ? err : 0);
+    } while (err);
+}
+
+/*! \fn int deu_dma_enqueue(struct skcipher_request *req)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief queue a request for the DMA engine
+ *  \param req skcipher request, its context must be a prepared struct deu_dma_reqctx
+ *  \return -EINPROGRESS, -EBUSY if the request went to the backlog
+*/
+int deu_dma_enqueue(struct skcipher_request *req)
+{
+    unsigned long flag;
+    int ret, start;
+
+    spin_lock_irqsave(&deu_dma.lock, flag);
+    ret = crypto_enqueue_request(&deu_dma.queue, &req->base);
+    start = !deu_dma.busy;
+    deu_dma.busy = 1;
+    spin_unlock_irqrestore(&deu_dma.lock, flag);
+
+    if (start)
+        deu_dma_next();
+
+    return ret;
+}
+
+/*! \fn static int deu_dma_hw_done(void)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief check whether the last receive descriptor of the running request has been written back
+*/
+static int deu_dma_hw_done(void)
+{
+    u32 ctl = deu_dma.rx.desc_base[deu_dma.last_rx].ctl;
+
+    return (ctl & (LTQ_DMA_OWN | LTQ_DMA_C)) == LTQ_DMA_C;
+}
+
+/*! \fn void deu_dma_wait_idle(void)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief called by the PIO paths with their unit lock held, spins until a running DMA transfer drained
+*/
+void deu_dma_wait_idle(void)
+{
+    volatile struct deu_dma_t *dma = (struct deu_dma_t *) IFX_DEU_DMA_CON;
+
+    if (!deu_dma.active)
+        return;
+
+    while (!deu_dma_hw_done())
+        cpu_relax();
+
+    dma->controlr.EN = 0;
+}
+
+/*! \fn static void deu_dma_done_tasklet(unsigned long data)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief completes the running request and starts the next one
+*/
+static void deu_dma_done_tasklet(unsigned long data)
+{
+    volatile struct deu_dma_t *dma = (struct deu_dma_t *) IFX_DEU_DMA_CON;
+    struct skcipher_request *req = deu_dma.cur;
+
+    if (!deu_dma.active || !deu_dma_hw_done()) {
+        ltq_dma_enable_irq(&deu_dma.rx);
+        return;
+    }
+
+    dma->controlr.EN = 0;
+    deu_dma_clean_ring(&deu_dma.rx, deu_dma.dst_mapped);
+    deu_dma_clean_ring(&deu_dma.tx, deu_dma.src_mapped);
+    deu_dma.active = 0;
+    deu_dma.cur = NULL;
+
+    deu_dma_unmap();
+    ltq_dma_enable_irq(&deu_dma.rx);
+
+    deu_dma_finish(req, 0);
+    deu_dma_next();
+}
+
+/*! \fn static irqreturn_t deu_dma_irq(int irq, void *priv)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief rx channel interrupt, defers the completion to the tasklet
+*/
+static irqreturn_t deu_dma_irq(int irq, void *priv)
+{
+    ltq_dma_disable_irq(&deu_dma.rx);
+    ltq_dma_ack_irq(&deu_dma.rx);
+    tasklet_schedule(&deu_dma.done_task);
+
+    return IRQ_HANDLED;
+}
+
+/*! \fn int deu_dma_init(struct device *dev)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief set up the DEU port of the central DMA and the completion interrupt
+ *  \param dev DEU platform device, used for the DMA mappings
+ *  \return 0 on success
+*/
+int deu_dma_init(struct device *dev)
+{
+    int ret;
+
+    deu_dma.dev = dev;
+    spin_lock_init(&deu_dma.lock);
+    crypto_init_queue(&deu_dma.queue, DEU_DMA_QUEUE_LEN);
+    tasklet_init(&deu_dma.done_task, deu_dma_done_tasklet, 0);
+
+    ltq_dma_init_port(DMA_PORT_DEU);
+
+    deu_dma.rx.nr = DEU_DMA_RX_CHAN;
+    deu_dma.rx.irq = DEU_DMA_IRQ;
+    ltq_dma_alloc_rx(&deu_dma.rx);
+
+    deu_dma.tx.nr = DEU_DMA_TX_CHAN;
+    ltq_dma_alloc_tx(&deu_dma.tx);
+
+    ret = request_irq(deu_dma.rx.irq, deu_dma_irq, 0, "deu_dma", &deu_dma);
+    if (ret) {
+        printk(KERN_ERR "IFX DEU DMA: failed to request irq %d\n", deu_dma.rx.irq);
+        ltq_dma_free(&deu_dma.tx);
+        ltq_dma_free(&deu_dma.rx);
+        return ret;
+    }
+
+    ltq_dma_open(&deu_dma.tx);
+    ltq_dma_open(&deu_dma.rx);
+    ltq_dma_enable_irq(&deu_dma.rx);
+
+    return 0;
+}
+
+/*! \fn void __exit ifxdeu_fini_dma(void)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief release DMA channels and interrupt
+*/
+void __exit ifxdeu_fini_dma(void)
+{
+    ltq_dma_close(&deu_dma.rx);
+    ltq_dma_close(&deu_dma.tx);
+    free_irq(deu_dma.rx.irq, &deu_dma);
+    tasklet_kill(&deu_dma.done_task);
+    ltq_dma_free(&deu_dma.tx);
+    ltq_dma_free(&deu_dma.rx);
+}
+
+#ifdef CONFIG_CRYPTO_DEV_SPEED_TEST
+
+static int speed_test_sec = 0;
+module_param(speed_test_sec, int, 0);
+MODULE_PARM_DESC(speed_test_sec,
+          "Compare the DMA and PIO throughput of each algorithm for n seconds per key and block size.");
+
+/* 1472 is a full ESP payload on a 1500 byte MTU link */
+static const unsigned int deu_speed_block_sizes[] = { 16, 64, 256, 1024, 1472, 8192, 0 };
+static const unsigned int deu_speed_aes_keys[] = { 16, 24, 32, 0 };
+static const unsigned int deu_speed_des3_keys[] = { 24, 0 };
+
+struct deu_speed_result {
+    struct completion completion;
+    int err;
+};
+
+static void deu_speed_complete(struct crypto_async_request *req, int err)
+{
+    struct deu_speed_result *res = req->data;
+
+    if (err == -EINPROGRESS)
+        return;
+
+    res->err = err;
+    complete(&res->completion);
+}
+
+static int deu_speed_encrypt(struct skcipher_request *req, struct deu_speed_result *res)
+{
+    int ret = crypto_skcipher_encrypt(req);
+
+    if (ret == -EINPROGRESS || ret == -EBUSY) {
+        wait_for_completion(&res->completion);
+        reinit_completion(&res->completion);
+        ret = res->err;
+    }
+
+    return ret;
+}
+
+/*! \fn static long deu_speed_run(const char *driver, unsigned int keylen, unsigned int blen, unsigned int sec)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief encrypt blocks of blen bytes back to back for sec seconds
+ *  \return throughput in KB/s, negative error code on failure
+*/
+static long deu_speed_run(const char *driver, unsigned int keylen,
+                          unsigned int blen, unsigned int sec)
+{
+    struct crypto_skcipher *tfm;
+    struct skcipher_request *req;
+    struct deu_speed_result res;
+    struct scatterlist sg;
+    unsigned long end;
+    u64 bytes = 0;
+    u8 key[32], iv[16];
+    u8 *buf;
+    long ret;
+    int i;
+
+    tfm = crypto_alloc_skcipher(driver, 0, 0);
+    if (IS_ERR(tfm))
+        return PTR_ERR(tfm);
+
+    req = skcipher_request_alloc(tfm, GFP_KERNEL);
+    buf = kmalloc(blen, GFP_KERNEL);
+    if (!req || !buf) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    /* distinct key words, 3DES rejects keys with equal parts */
+    for (i = 0; i < sizeof(key); i++)
+        key[i] = i + 1;
+
+    ret = crypto_skcipher_setkey(tfm, key, keylen);
+    if (ret)
+        goto out;
+
+    init_completion(&res.completion);
+    skcipher_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+                                  deu_speed_complete, &res);
+
+    memset(buf, 0xff, blen);
+    memset(iv, 0xff, sizeof(iv));
+    sg_init_one(&sg, buf, blen);
+    skcipher_request_set_crypt(req, &sg, &sg, blen, iv);
+
+    end = jiffies + sec * HZ;
+    while (time_before(jiffies, end)) {
+        ret = deu_speed_encrypt(req, &res);
+        if (ret)
+            goto out;
+        bytes += blen;
+    }
+
+    do_div(bytes, sec * 1024);
+    ret = bytes;
+
+out:
+    kfree(buf);
+    skcipher_request_free(req);
+    crypto_free_skcipher(tfm);
+    return ret;
+}
+
+/*! \fn static void deu_speed_compare(const char *alg, const char *dma_drv, const char *pio_drv, const unsigned int *keys, unsigned int sec)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief print the throughput of the DMA and the PIO implementation of an algorithm side by side
+*/
+static void deu_speed_compare(const char *alg, const char *dma_drv,
+                              const char *pio_drv, const unsigned int *keys,
+                              unsigned int sec)
+{
+    const unsigned int *blen;
+    long dma, pio;
+
+    printk(KERN_INFO "\ntesting speed of %s encryption, %s against %s\n",
+           alg, dma_drv, pio_drv);
+
+    for (; *keys; keys++) {
+        for (blen = deu_speed_block_sizes; *blen; blen++) {
+            dma = deu_speed_run(dma_drv, *keys, *blen, sec);
+            pio = deu_speed_run(pio_drv, *keys, *blen, sec);
+            if (dma < 0 || pio < 0) {
+                printk(KERN_ERR "%s speed test failed: dma %ld, pio %ld\n",
+                       alg, dma, pio);
+                return;
+            }
+
+            printk(KERN_INFO "%3u bit key, %4u byte blocks: "
+                   "dma %6ld KB/s, pio %6ld KB/s\n",
+                   *keys * 8, *blen, dma, pio);
+        }
+    }
+}
+
+/*! \fn void deu_dma_speed_test(void)
+ *  \ingroup IFX_DMA_FUNCTIONS
+ *  \brief run the speed test if requested by the speed_test_sec module parameter
+*/
+void deu_dma_speed_test(void)
+{
+    if (speed_test_sec <= 0)
+        return;
+
+    deu_speed_compare("ecb(aes)", "ifxdeu-dma-ecb(aes)", "ifxdeu-ecb(aes)",
+                      deu_speed_aes_keys, speed_test_sec);
+    deu_speed_compare("cbc(aes)", "ifxdeu-dma-cbc(aes)", "ifxdeu-cbc(aes)",
+                      deu_speed_aes_keys, speed_test_sec);
+    deu_speed_compare("ctr(aes)", "ifxdeu-dma-ctr(aes)", "ifxdeu-ctr(aes)",
+                      deu_speed_aes_keys, speed_test_sec);
+    deu_speed_compare("cbc(des3_ede)", "ifxdeu-dma-cbc(des3_ede)",
+                      "ifxdeu-cbc(des3_ede)", deu_speed_des3_keys,
+                      speed_test_sec);
+}
+
+#else
+
+void deu_dma_speed_test(void)
+{
+}
+
+#endif /* CONFIG_CRYPTO_DEV_SPEED_TEST */
@@ -39,31 +39,57 @@
 #include <asm/byteorder.h>
 #include <linux/skbuff.h>
 #include <linux/netdevice.h>
+#include <crypto/internal/skcipher.h>
 
 // must match the size of memory block allocated for g_dma_block and g_dma_block2
 #define DEU_MAX_PACKET_SIZE    (PAGE_SIZE >> 1)
 
-typedef struct ifx_deu_device {
-	struct dma_device_info *dma_device;
-	u8 *dst;
-	u8 *src;
-	int len;
-	int dst_count;
-	int src_count;
-	int recv_count;
-	int packet_size;
-	int packet_num;
-	wait_queue_t wait;
-} _ifx_deu_device;
+/* central DMA channels wired to the DEU port (even = rx, odd = tx) */
+#define DEU_DMA_RX_CHAN         10
+#define DEU_DMA_TX_CHAN         11
 
-extern _ifx_deu_device ifx_deu[1];
+/* max. scatterlist entries mapped per request before falling back to a bounce buffer */
+#define DEU_DMA_MAX_SEGS        16
+#define DEU_DMA_QUEUE_LEN       50
 
-extern int deu_dma_intr_handler (struct dma_device_info *, int);
-extern u8 *deu_dma_buffer_alloc (int, int *, void **);
-extern int deu_dma_buffer_free (u8 *, void *);
-extern void deu_dma_inactivate_poll(struct dma_device_info* dma_dev);
-extern void deu_dma_activate_poll (struct dma_device_info* dma_dev);
-extern struct dma_device_info* deu_dma_reserve(struct dma_device_info** dma_device);
-extern int deu_dma_release(struct dma_device_info** dma_device);
+/* values for the ALGO field of the DEU DMA control register */
+#define DEU_DMA_ALGO_DES        0
+#define DEU_DMA_ALGO_AES        1
+
+/**
+ *	struct deu_dma_ops - per algorithm hooks of the DMA engine
+ *	@algo: DEU_DMA_ALGO_xxx unit the data is routed to
+ *	@blocksize: cipher block size, requests are padded up to it
+ *	@setup: program key, IV and mode into the unit, called with the
+ *	        unit locks held right before the descriptors are handed over
+ *	@done: update req->iv once the output is written, called from the
+ *	       completion tasklet
+ *	@pio: process a linear copy of the request in place with the PIO
+ *	      routine of the unit, used when the request cannot be mapped
+*/
+struct deu_dma_ops {
+    u32 algo;
+    unsigned int blocksize;
+    void (*setup)(struct skcipher_request *req);
+    void (*done)(struct skcipher_request *req);
+    void (*pio)(struct skcipher_request *req, u8 *buf, unsigned int len, u8 *iv);
+};
+
+/**
+ *	struct deu_dma_reqctx - per request state, used as skcipher reqsize
+ *	@ops: algorithm hooks
+ *	@encdec: CRYPTO_DIR_ENCRYPT or CRYPTO_DIR_DECRYPT
+ *	@mode: hw operation mode (0 ECB 1 CBC 2 OFB 3 CFB 4 CTR)
+ *	@iv: chaining value saved before an in-place decrypt overwrites it
+*/
+struct deu_dma_reqctx {
+    const struct deu_dma_ops *ops;
+    int encdec;
+    int mode;
+    u8 iv[16];
+};
+
+extern int deu_dma_enqueue(struct skcipher_request *req);
+extern void deu_dma_speed_test(void);
 
 #endif	/* IFMIPS_DEU_DMA_H */
@@ -66,10 +66,11 @@
 
 #define SHA1_HMAC_MAX_KEYLEN 64
 
-static spinlock_t lock;
-#define CRTCL_SECT_INIT        spin_lock_init(&lock)
-#define CRTCL_SECT_START       spin_lock_irqsave(&lock, flag)
-#define CRTCL_SECT_END         spin_unlock_irqrestore(&lock, flag)
+/* shared with the authenc driver, which drives the hash unit directly */
+spinlock_t sha1_hmac_lock;
+#define CRTCL_SECT_INIT        spin_lock_init(&sha1_hmac_lock)
+#define CRTCL_SECT_START       spin_lock_irqsave(&sha1_hmac_lock, flag)
+#define CRTCL_SECT_END         spin_unlock_irqrestore(&sha1_hmac_lock, flag)
 
 #ifdef CRYPTO_DEBUG
 extern char debug_level;
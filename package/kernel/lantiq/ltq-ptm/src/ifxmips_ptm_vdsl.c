@@ -33,6 +33,9 @@
 #include <linux/etherdevice.h>
 #include <linux/interrupt.h>
 #include <linux/netdevice.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <asm/timex.h>
 
 #include "ifxmips_ptm_vdsl.h"
 #include <lantiq_soc.h>
@@ -42,6 +45,7 @@
 
 static int wanqos_en = 0;
 static int queue_gamma_map[4] = {0xFE, 0x01, 0x00, 0x00};
+static int napi_weight = NAPI_POLL_WEIGHT;
 
 MODULE_PARM(wanqos_en, "i");
 MODULE_PARM_DESC(wanqos_en, "WAN QoS support, 1 - enabled, 0 - disabled.");
@@ -49,6 +53,9 @@ MODULE_PARM_DESC(wanqos_en, "WAN QoS support, 1 - enabled, 0 - disabled.");
 MODULE_PARM_ARRAY(queue_gamma_map, "4-4i");
 MODULE_PARM_DESC(queue_gamma_map, "TX QoS queues mapping to 4 TX Gamma interfaces.");
 
+MODULE_PARM(napi_weight, "i");
+MODULE_PARM_DESC(napi_weight, "Max number of RX packets per NAPI poll, 1 - WAN_RX_DESC_NUM.");
+
 extern int (*ifx_mei_atm_showtime_enter)(struct port_cell_info *, void *);
 extern int (*ifx_mei_atm_showtime_exit)(void);
 extern int ifx_mei_atm_showtime_check(int *is_showtime, struct port_cell_info *port_cell, void **xdata_addr);
@@ -72,14 +79,17 @@ static struct net_device_stats *ptm_get_stats(struct net_device *);
 static int ptm_open(struct net_device *);
 static int ptm_stop(struct net_device *);
   static unsigned int ptm_poll(int, unsigned int);
+  static int ptm_swap_refill(struct napi_struct *, int);
   static int ptm_napi_poll(struct napi_struct *, int);
 static int ptm_hard_start_xmit(struct sk_buff *, struct net_device *);
 static int ptm_change_mtu(struct net_device *, int);
 static int ptm_ioctl(struct net_device *, struct ifreq *, int);
 static void ptm_tx_timeout(struct net_device *);
 
-static inline struct sk_buff* alloc_skb_rx(void);
+static inline void *alloc_rx_buf(int);
+static inline void *get_rx_buf_pointer(unsigned int);
 static inline struct sk_buff* alloc_skb_tx(unsigned int);
+static inline void set_swap_buf(volatile struct tx_descriptor *, struct sk_buff *);
 static inline struct sk_buff *get_skb_pointer(unsigned int);
 static inline int get_tx_desc(unsigned int, unsigned int *);
 
@@ -89,9 +99,12 @@ static inline int get_tx_desc(unsigned int, unsigned int *);
 static irqreturn_t mailbox_irq_handler(int, void *);
 
 /*
- *  Tasklet to Handle Swap Descriptors
+ *  Per-stage timing, exported through debugfs
  */
-static void do_swap_desc_tasklet(unsigned long);
+static inline cycles_t stage_start(void);
+static inline void stage_end(int, cycles_t);
+static void ptm_debugfs_init(void);
+static void ptm_debugfs_exit(void);
 
 
 /*
@@ -125,7 +138,7 @@ static char *g_net_dev_name[1] = {"dsl0"};
 
 static int g_ptm_prio_queue_map[8];
 
-static DECLARE_TASKLET(g_swap_desc_tasklet, do_swap_desc_tasklet, 0);
+static struct dentry *g_ptm_debugfs_dir;
 
 
 unsigned int ifx_ptm_dbg_enable = DBG_ENABLE_MASK_ERR;
@@ -141,7 +154,7 @@ static void ptm_setup(struct net_device *dev, int ndev)
     netif_carrier_off(dev);
 
     dev->netdev_ops      = &g_ptm_netdev_ops;
-    netif_napi_add(dev, &g_ptm_priv_data.itf[ndev].napi, ptm_napi_poll, 16);
+    netif_napi_add(dev, &g_ptm_priv_data.itf[ndev].napi, ptm_napi_poll, napi_weight);
     dev->watchdog_timeo  = ETH_WATCHDOG_TIMEOUT;
 
     dev->dev_addr[0] = 0x00;
@@ -169,10 +182,13 @@ static int ptm_open(struct net_device *dev)
 
     napi_enable(&g_ptm_priv_data.itf[0].napi);
 
-    IFX_REG_W32_MASK(0, 1, MBOX_IGU1_IER);
+    IFX_REG_W32_MASK(0, 1 | (1 << 16), MBOX_IGU1_IER);
 
     netif_start_queue(dev);
 
+    //  pick up swap descriptors returned while the interface was down
+    napi_schedule(&g_ptm_priv_data.itf[0].napi);
+
     return 0;
 }
 
@@ -180,7 +196,7 @@ static int ptm_stop(struct net_device *dev)
 {
     ASSERT(dev == g_net_dev[0], "incorrect device");
 
-    IFX_REG_W32_MASK(1 | (1 << 17), 0, MBOX_IGU1_IER);
+    IFX_REG_W32_MASK(1 | (1 << 16) | (1 << 17), 0, MBOX_IGU1_IER);
 
     napi_disable(&g_ptm_priv_data.itf[0].napi);
 
@@ -194,7 +210,9 @@ static unsigned int ptm_poll(int ndev, unsigned int work_to_do)
     unsigned int work_done = 0;
     volatile struct rx_descriptor *desc;
     struct rx_descriptor reg_desc;
-    struct sk_buff *skb, *new_skb;
+    struct sk_buff *skb;
+    void *buf, *new_buf;
+    cycles_t t;
 
     ASSERT(ndev >= 0 && ndev < ARRAY_SIZE(g_net_dev), "ndev = %d (wrong value)", ndev);
 
@@ -206,29 +224,37 @@ static unsigned int ptm_poll(int ndev, unsigned int work_to_do)
             g_ptm_priv_data.itf[0].rx_desc_pos = 0;
 
         reg_desc = *desc;
-        skb = get_skb_pointer(reg_desc.dataptr);
-        ASSERT(skb != NULL, "invalid pointer skb == NULL");
+        buf = get_rx_buf_pointer(reg_desc.dataptr);
+
+        t = stage_start();
+        new_buf = alloc_rx_buf(1);
+        stage_end(PTM_STAGE_RX_REFILL, t);
 
-        new_skb = alloc_skb_rx();
-        if ( new_skb != NULL ) {
-            skb_reserve(skb, reg_desc.byteoff);
+        //  no memory: drop the frame and hand the old buffer back to PP32
+        skb = new_buf != NULL ? build_skb(buf, RX_FRAG_SIZE) : NULL;
+        if ( skb != NULL ) {
+            skb_reserve(skb, RX_FRAG_HEADROOM + reg_desc.byteoff);
             skb_put(skb, reg_desc.datalen);
 
             //  parse protocol header
-            skb->dev = g_net_dev[0];
-            skb->protocol = eth_type_trans(skb, skb->dev);
+            skb->protocol = eth_type_trans(skb, g_net_dev[0]);
 
             g_net_dev[0]->last_rx = jiffies;
 
-            netif_receive_skb(skb);
+            napi_gro_receive(&g_ptm_priv_data.itf[0].napi, skb);
 
             g_ptm_priv_data.itf[0].stats.rx_packets++;
             g_ptm_priv_data.itf[0].stats.rx_bytes += reg_desc.datalen;
 
-            reg_desc.dataptr = (unsigned int)new_skb->data & 0x0FFFFFFF;
-            reg_desc.byteoff = RX_HEAD_MAC_ADDR_ALIGNMENT;
+            reg_desc.dataptr = ((unsigned int)new_buf + RX_FRAG_HEADROOM) & 0x0FFFFFFF;
+        }
+        else {
+            if ( new_buf != NULL )
+                skb_free_frag(new_buf);
+            g_ptm_priv_data.itf[0].stats.rx_dropped++;
         }
 
+        reg_desc.byteoff = RX_HEAD_MAC_ADDR_ALIGNMENT;
         reg_desc.datalen = RX_MAX_BUFFER_SIZE - RX_HEAD_MAC_ADDR_ALIGNMENT;
         reg_desc.own     = 1;
         reg_desc.c       = 0;
@@ -244,12 +270,62 @@ static unsigned int ptm_poll(int ndev, unsigned int work_to_do)
     return work_done;
 }
 
+/*
+ *  Swap descriptors return buffers PP32 has finished with and take a fresh
+ *  one in exchange. They are handled here rather than in a tasklet of their
+ *  own; returned skbs go back through napi_consume_skb() so they are freed
+ *  in bulk. Returns non-zero if descriptors are still waiting.
+ */
+static int ptm_swap_refill(struct napi_struct *napi, int budget)
+{
+    struct ptm_itf *p_itf = &g_ptm_priv_data.itf[0];
+    volatile struct tx_descriptor *desc;
+    struct sk_buff *skb, *new_skb;
+    int i;
+
+    for ( i = 0; i < WAN_SWAP_DESC_NUM; i++ ) {
+        desc = &WAN_SWAP_DESC_BASE[p_itf->tx_swap_desc_pos];
+        if ( desc->own )    //  if PP32 hold descriptor
+            return 0;
+
+        new_skb = napi_alloc_skb(napi, RX_MAX_BUFFER_SIZE + DATA_BUFFER_ALIGNMENT);
+        if ( new_skb == NULL )
+            return 0;   //  retry on next swap interrupt
+
+        skb = get_skb_pointer(desc->dataptr);
+        if ( skb != NULL )
+            napi_consume_skb(skb, budget);
+
+        set_swap_buf(desc, new_skb);
+
+        if ( ++p_itf->tx_swap_desc_pos == WAN_SWAP_DESC_NUM )
+            p_itf->tx_swap_desc_pos = 0;
+    }
+
+    return !WAN_SWAP_DESC_BASE[p_itf->tx_swap_desc_pos].own;
+}
+
 static int ptm_napi_poll(struct napi_struct *napi, int budget)
 {
     int ndev = 0;
     unsigned int work_done;
+    int swap_pending;
+    cycles_t t_poll, t;
+
+    t_poll = stage_start();
 
+    //  clear interrupt before looking at the rings, so nothing is missed
+    IFX_REG_W32(1 | (1 << 16), MBOX_IGU1_ISRC);
+
+    t = stage_start();
+    swap_pending = ptm_swap_refill(napi, budget);
+    stage_end(PTM_STAGE_SWAP, t);
+
+    t = stage_start();
     work_done = ptm_poll(ndev, budget);
+    stage_end(PTM_STAGE_RX, t);
+
+    stage_end(PTM_STAGE_POLL, t_poll);
 
     //  interface down
     if ( !netif_running(napi->dev) ) {
@@ -257,17 +333,15 @@ static int ptm_napi_poll(struct napi_struct *napi, int budget)
         return work_done;
     }
 
-    //  clear interrupt
-    IFX_REG_W32_MASK(0, 1, MBOX_IGU1_ISRC);
     //  no more traffic
-    if (work_done < budget) {
-	napi_complete(napi);
-        IFX_REG_W32_MASK(0, 1, MBOX_IGU1_IER);
+    if ( work_done < budget && !swap_pending && WAN_RX_DESC_BASE[g_ptm_priv_data.itf[0].rx_desc_pos].own ) {
+        napi_complete_done(napi, work_done);
+        IFX_REG_W32_MASK(0, 1 | (1 << 16), MBOX_IGU1_IER);
         return work_done;
     }
 
     //  next round
-    return work_done;
+    return budget;
 }
 
 static int ptm_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
@@ -478,26 +552,27 @@ static void ptm_tx_timeout(struct net_device *dev)
     return;
 }
 
-static inline struct sk_buff* alloc_skb_rx(void)
+/*
+ *  RX buffers are page fragments, the skb is only built around a buffer once
+ *  PP32 has filled it. The page fragment allocator recycles the page as soon
+ *  as the stack has released all frames carved from it.
+ */
+static inline void *alloc_rx_buf(int in_napi)
 {
-    struct sk_buff *skb;
+    void *buf;
 
-    /*  allocate memroy including trailer and padding   */
-    skb = dev_alloc_skb(RX_MAX_BUFFER_SIZE + DATA_BUFFER_ALIGNMENT);
-    if ( skb != NULL ) {
-        /*  must be burst length alignment and reserve two more bytes for MAC address alignment  */
-        if ( ((unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1)) != 0 )
-            skb_reserve(skb, ~((unsigned int)skb->data + (DATA_BUFFER_ALIGNMENT - 1)) & (DATA_BUFFER_ALIGNMENT - 1));
-        /*  pub skb in reserved area "skb->data - 4"    */
-        *((struct sk_buff **)skb->data - 1) = skb;
-        wmb();
-        /*  write back and invalidate cache    */
-        dma_cache_wback_inv((unsigned long)skb->data - sizeof(skb), sizeof(skb));
+    buf = in_napi ? napi_alloc_frag(RX_FRAG_SIZE) : netdev_alloc_frag(RX_FRAG_SIZE);
+    if ( buf != NULL ) {
         /*  invalidate cache    */
-        dma_cache_inv((unsigned long)skb->data, (unsigned int)skb->end - (unsigned int)skb->data);
+        dma_cache_inv((unsigned long)buf + RX_FRAG_HEADROOM, RX_MAX_BUFFER_SIZE);
     }
 
-    return skb;
+    return buf;
+}
+
+static inline void *get_rx_buf_pointer(unsigned int dataptr)
+{
+    return (void *)((dataptr | KSEG0) - RX_FRAG_HEADROOM);
 }
 
 static inline struct sk_buff* alloc_skb_tx(unsigned int size)
@@ -514,6 +589,20 @@ static inline struct sk_buff* alloc_skb_tx(unsigned int size)
     return skb;
 }
 
+static inline void set_swap_buf(volatile struct tx_descriptor *desc, struct sk_buff *skb)
+{
+    unsigned int byteoff;
+
+    /*  must be burst length alignment  */
+    skb_reserve(skb, ~((unsigned int)skb->data + (DATA_BUFFER_ALIGNMENT - 1)) & (DATA_BUFFER_ALIGNMENT - 1));
+    byteoff = (unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1);
+    *(struct sk_buff **)((unsigned int)skb->data - byteoff - sizeof(struct sk_buff *)) = skb;
+
+    desc->dataptr = (unsigned int)skb->data & 0x0FFFFFFF;
+    wmb();
+    desc->own = 1;
+}
+
 static inline struct sk_buff *get_skb_pointer(unsigned int dataptr)
 {
     unsigned int skb_dataptr;
@@ -580,7 +669,7 @@ static irqreturn_t mailbox_irq_handler(int irq, void *dev_id)
             }
 	   if (isr & BIT(16)) {
                 IFX_REG_W32_MASK(1 << 16, 0, MBOX_IGU1_IER);
-                tasklet_hi_schedule(&g_swap_desc_tasklet);
+                napi_schedule(&g_ptm_priv_data.itf[0].napi);
             }
 	    if (isr & BIT(17)) {
                 IFX_REG_W32_MASK(1 << 17, 0, MBOX_IGU1_IER);
@@ -590,45 +679,86 @@ static irqreturn_t mailbox_irq_handler(int irq, void *dev_id)
     return IRQ_HANDLED;
 }
 
-static void do_swap_desc_tasklet(unsigned long arg)
+static inline cycles_t stage_start(void)
 {
-    int budget = 32;
-    volatile struct tx_descriptor *desc;
-    struct sk_buff *skb;
-    unsigned int byteoff;
+    return g_ptm_priv_data.stage_en ? get_cycles() : 0;
+}
 
-    while ( budget-- > 0 ) {
-	if ( WAN_SWAP_DESC_BASE[g_ptm_priv_data.itf[0].tx_swap_desc_pos].own )  //  if PP32 hold descriptor
-            break;
+static inline void stage_end(int stage, cycles_t start)
+{
+    struct ptm_stage_stat *p = &g_ptm_priv_data.stage[stage];
+    unsigned int delta;
 
-        desc = &WAN_SWAP_DESC_BASE[g_ptm_priv_data.itf[0].tx_swap_desc_pos];
-        if ( ++g_ptm_priv_data.itf[0].tx_swap_desc_pos == WAN_SWAP_DESC_NUM )
-            g_ptm_priv_data.itf[0].tx_swap_desc_pos = 0;
+    if ( !g_ptm_priv_data.stage_en )
+        return;
 
-        skb = get_skb_pointer(desc->dataptr);
-        if ( skb != NULL )
-            dev_kfree_skb_any(skb);
+    delta = (unsigned int)(get_cycles() - start);
+    p->count++;
+    p->total += delta;
+    if ( delta > p->max )
+        p->max = delta;
+}
 
-        skb = alloc_skb_tx(RX_MAX_BUFFER_SIZE);
-        if ( skb == NULL )
-            panic("can't allocate swap buffer for PPE firmware use\n");
-        byteoff = (unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1);
-        *(struct sk_buff **)((unsigned int)skb->data - byteoff - sizeof(struct sk_buff *)) = skb;
+static int ptm_stage_show(struct seq_file *m, void *v)
+{
+    static const char *stage_name[PTM_STAGE_NUM] = {
+        [PTM_STAGE_POLL]        = "poll",
+        [PTM_STAGE_RX]          = "rx",
+        [PTM_STAGE_RX_REFILL]   = "rx_refill",
+        [PTM_STAGE_SWAP]        = "swap",
+    };
+    struct ptm_stage_stat *p;
+    int i;
 
-        desc->dataptr = (unsigned int)skb->data & 0x0FFFFFFF;
-        desc->own = 1;
+    seq_printf(m, "%-10s %10s %14s %10s %10s\n", "stage", "count", "total_cycles", "avg", "max");
+    for ( i = 0; i < PTM_STAGE_NUM; i++ ) {
+        p = &g_ptm_priv_data.stage[i];
+        seq_printf(m, "%-10s %10u %14llu %10u %10u\n", stage_name[i], p->count,
+                   (unsigned long long)p->total,
+                   p->count ? (unsigned int)div_u64(p->total, p->count) : 0, p->max);
     }
 
-    //  clear interrupt
-    IFX_REG_W32_MASK(0, 16, MBOX_IGU1_ISRC);
-    //  no more skb to be replaced
-    if ( WAN_SWAP_DESC_BASE[g_ptm_priv_data.itf[0].tx_swap_desc_pos].own ) {    //  if PP32 hold descriptor
-        IFX_REG_W32_MASK(0, 1 << 16, MBOX_IGU1_IER);
+    return 0;
+}
+
+static int ptm_stage_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, ptm_stage_show, NULL);
+}
+
+static ssize_t ptm_stage_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
+{
+    //  any write clears the counters
+    memset(g_ptm_priv_data.stage, 0, sizeof(g_ptm_priv_data.stage));
+
+    return count;
+}
+
+static const struct file_operations g_ptm_stage_fops = {
+    .owner      = THIS_MODULE,
+    .open       = ptm_stage_open,
+    .read       = seq_read,
+    .write      = ptm_stage_write,
+    .llseek     = seq_lseek,
+    .release    = single_release,
+};
+
+static void ptm_debugfs_init(void)
+{
+    g_ptm_debugfs_dir = debugfs_create_dir("ltq_ptm", NULL);
+    if ( IS_ERR_OR_NULL(g_ptm_debugfs_dir) ) {
+        g_ptm_debugfs_dir = NULL;
         return;
     }
 
-    tasklet_hi_schedule(&g_swap_desc_tasklet);
-    return;
+    debugfs_create_bool("timing_enable", 0600, g_ptm_debugfs_dir, &g_ptm_priv_data.stage_en);
+    debugfs_create_file("timing", 0600, g_ptm_debugfs_dir, NULL, &g_ptm_stage_fops);
+}
+
+static void ptm_debugfs_exit(void)
+{
+    debugfs_remove_recursive(g_ptm_debugfs_dir);
+    g_ptm_debugfs_dir = NULL;
 }
 
 
@@ -660,6 +790,11 @@ static inline int init_priv_data(void)
             g_queue_gamma_map[i] &= ~g_queue_gamma_map[j];
     }
 
+    if ( napi_weight < 1 )
+        napi_weight = 1;
+    else if ( napi_weight > WAN_RX_DESC_NUM )
+        napi_weight = WAN_RX_DESC_NUM;
+
     memset(&g_ptm_priv_data, 0, sizeof(g_ptm_priv_data));
 
     {
@@ -683,7 +818,8 @@ static inline void clear_priv_data(void)
 
 static inline int init_tables(void)
 {
-    struct sk_buff *skb_pool[WAN_RX_DESC_NUM] = {0};
+    void *rx_buf_pool[WAN_RX_DESC_NUM] = {0};
+    struct sk_buff *swap_pool[WAN_SWAP_DESC_NUM] = {0};
     struct cfg_std_data_len cfg_std_data_len = {0};
     struct tx_qos_cfg tx_qos_cfg = {0};
     struct psave_cfg psave_cfg = {0};
@@ -701,11 +837,17 @@ static inline int init_tables(void)
     int i;
 
     for ( i = 0; i < WAN_RX_DESC_NUM; i++ ) {
-        skb_pool[i] = alloc_skb_rx();
-        if ( skb_pool[i] == NULL )
+        rx_buf_pool[i] = alloc_rx_buf(0);
+        if ( rx_buf_pool[i] == NULL )
             goto ALLOC_SKB_RX_FAIL;
     }
 
+    for ( i = 0; i < WAN_SWAP_DESC_NUM; i++ ) {
+        swap_pool[i] = dev_alloc_skb(RX_MAX_BUFFER_SIZE + DATA_BUFFER_ALIGNMENT);
+        if ( swap_pool[i] == NULL )
+            goto ALLOC_SKB_SWAP_FAIL;
+    }
+
     cfg_std_data_len.byte_off = RX_HEAD_MAC_ADDR_ALIGNMENT; //  this field replaces byte_off in rx descriptor of VDSL ingress
     cfg_std_data_len.data_len = 1600;
     *CFG_STD_DATA_LEN = cfg_std_data_len;
@@ -834,7 +976,7 @@ static inline int init_tables(void)
     rx_desc.byteoff = RX_HEAD_MAC_ADDR_ALIGNMENT;
     rx_desc.datalen = RX_MAX_BUFFER_SIZE - RX_HEAD_MAC_ADDR_ALIGNMENT;
     for ( i = 0; i < WAN_RX_DESC_NUM; i++ ) {
-        rx_desc.dataptr = (unsigned int)skb_pool[i]->data & 0x0FFFFFFF;
+        rx_desc.dataptr = ((unsigned int)rx_buf_pool[i] + RX_FRAG_HEADROOM) & 0x0FFFFFFF;
         WAN_RX_DESC_BASE[i] = rx_desc;
     }
 
@@ -853,9 +995,11 @@ static inline int init_tables(void)
     for ( i = 0; i < WAN_TX_DESC_NUM_TOTAL; i++ )
         WAN_TX_DESC_BASE(0)[i] = tx_desc;
 
-    //  init Swap descriptor
-    for ( i = 0; i < WAN_SWAP_DESC_NUM; i++ )
+    //  init Swap descriptor, PP32 starts with a full ring
+    for ( i = 0; i < WAN_SWAP_DESC_NUM; i++ ) {
         WAN_SWAP_DESC_BASE[i] = tx_desc;
+        set_swap_buf(&WAN_SWAP_DESC_BASE[i], swap_pool[i]);
+    }
 
     //  init fastpath TX descriptor
     tx_desc.own     = 1;
@@ -864,9 +1008,13 @@ static inline int init_tables(void)
 
     return 0;
 
+ALLOC_SKB_SWAP_FAIL:
+    while ( i-- > 0 )
+        dev_kfree_skb_any(swap_pool[i]);
+    i = WAN_RX_DESC_NUM;
 ALLOC_SKB_RX_FAIL:
     while ( i-- > 0 )
-        dev_kfree_skb_any(skb_pool[i]);
+        skb_free_frag(rx_buf_pool[i]);
     return -1;
 }
 
@@ -875,11 +1023,9 @@ static inline void clear_tables(void)
     struct sk_buff *skb;
     int i, j;
 
-    for ( i = 0; i < WAN_RX_DESC_NUM; i++ ) {
-        skb = get_skb_pointer(WAN_RX_DESC_BASE[i].dataptr);
-        if ( skb != NULL )
-            dev_kfree_skb_any(skb);
-    }
+    for ( i = 0; i < WAN_RX_DESC_NUM; i++ )
+        if ( WAN_RX_DESC_BASE[i].dataptr != 0 )
+            skb_free_frag(get_rx_buf_pointer(WAN_RX_DESC_BASE[i].dataptr));
 
     for ( i = 0; i < CPU_TO_WAN_TX_DESC_NUM; i++ ) {
         skb = get_skb_pointer(CPU_TO_WAN_TX_DESC_BASE[i].dataptr);
@@ -1016,7 +1162,7 @@ static int ifx_ptm_init(void)
         err("ifx_pp32_start fail!");
         goto PP32_START_FAIL;
     }
-    IFX_REG_W32(1 << 16, MBOX_IGU1_IER);    //  enable SWAP interrupt
+    IFX_REG_W32(0, MBOX_IGU1_IER);          //  RX and SWAP interrupts are enabled in ptm_open
     IFX_REG_W32(~0, MBOX_IGU1_ISRC);
 
     enable_irq(PPE_MAILBOX_IGU1_INT);
@@ -1029,6 +1175,8 @@ static int ifx_ptm_init(void)
     ifx_mei_atm_showtime_enter = ptm_showtime_enter;
     ifx_mei_atm_showtime_exit  = ptm_showtime_exit;
 
+    ptm_debugfs_init();
+
     ifx_ptm_version(ver_str);
     printk(KERN_INFO "%s", ver_str);
 
@@ -1062,6 +1210,7 @@ static void __exit ifx_ptm_exit(void)
 	ifx_mei_atm_showtime_enter = NULL;
 	ifx_mei_atm_showtime_exit  = NULL;
 
+    ptm_debugfs_exit();
 
     ifx_pp32_stop(0);
 
@@ -76,6 +76,8 @@
 #define RX_TAIL_CRC_LENGTH              0   //  PTM firmware does not have ethernet frame CRC
                                             //  The len in descriptor doesn't include ETH_CRC
                                             //  because ETH_CRC may not present in some configuration
+#define RX_FRAG_HEADROOM                ALIGN(NET_SKB_PAD, DATA_BUFFER_ALIGNMENT)
+#define RX_FRAG_SIZE                    (SKB_DATA_ALIGN(RX_FRAG_HEADROOM + RX_MAX_BUFFER_SIZE) + SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
 
 
 
@@ -85,6 +87,20 @@
  * ####################################
  */
 
+enum {
+    PTM_STAGE_POLL = 0,     //  whole NAPI poll
+    PTM_STAGE_RX,           //  RX descriptors incl. stack delivery
+    PTM_STAGE_RX_REFILL,    //  RX buffer allocation
+    PTM_STAGE_SWAP,         //  swap descriptor free and refill
+    PTM_STAGE_NUM
+};
+
+struct ptm_stage_stat {
+    unsigned int                    count;
+    unsigned int                    max;
+    u64                             total;
+};
+
 struct ptm_itf {
     unsigned int                    rx_desc_pos;
 
@@ -99,6 +115,9 @@ struct ptm_itf {
 
 struct ptm_priv_data {
     struct ptm_itf                  itf[MAX_ITF_NUMBER];
+
+    bool                            stage_en;
+    struct ptm_stage_stat           stage[PTM_STAGE_NUM];
 };
 
 
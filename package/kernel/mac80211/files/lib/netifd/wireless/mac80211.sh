@@ -21,7 +21,7 @@ drv_mac80211_init_device_config() {
 	config_add_string hwmode
 	config_add_int beacon_int chanbw frag rts
 	config_add_int rxantenna txantenna antenna_gain txpower distance
-	config_add_boolean noscan ht_coex
+	config_add_boolean noscan ht_coex reconf
 	config_add_array ht_capab
 	config_add_array channels
 	config_add_boolean \
@@ -328,7 +328,7 @@ mac80211_hostapd_setup_bss() {
 	[ "$wds" -gt 0 ] && append hostapd_cfg "wds_sta=1" "$N"
 	[ "$staidx" -gt 0 -o "$start_disabled" -eq 1 ] && append hostapd_cfg "start_disabled=1" "$N"
 
-	cat >> /var/run/hostapd-$phy.conf <<EOF
+	cat >> "$hostapd_conf_file" <<EOF
 $hostapd_cfg
 bssid=$macaddr
 ${dtim_period:+dtim_period=$dtim_period}
@@ -411,6 +411,67 @@ mac80211_check_ap() {
 	has_ap=1
 }
 
+mac80211_check_other() {
+	has_other=1
+}
+
+# Print the pid of the hostapd instance of a phy, if it is still running
+# and all interfaces of the phy belong to it
+mac80211_hostapd_running() {
+	local phy="$1"
+	local pid wdev
+
+	read pid < /var/run/wifi-$phy.pid 2>/dev/null || return 1
+	grep -qs hostapd "/proc/$pid/cmdline" || return 1
+
+	for wdev in $(list_phy_interfaces "$phy"); do
+		grep -qsE "^(interface|bss)=$wdev\$" "$hostapd_conf_file" || return 1
+	done
+
+	echo "$pid"
+}
+
+# Print the part of a hostapd config that belongs to one BSS
+mac80211_hostapd_bss_conf() {
+	awk -v ifname="$2" '/^(interface|bss)=/ { cur = (substr($0, index($0, "=") + 1) == ifname) } cur' "$1"
+}
+
+# Hand the new config in $hostapd_conf_file.new to the running hostapd
+# and reload only the BSSes whose settings changed, so that the stations
+# of the others stay associated. BSSes cannot be added, removed or
+# reordered and the radio settings cannot change this way, so fail in
+# that case.
+mac80211_hostapd_reload() {
+	local conf="$hostapd_conf_file"
+	local bss_lines='^(interface|bss|bssid)='
+	local ifname
+
+	cmp -s "$conf" "$conf.new" && {
+		rm -f "$conf.new"
+		return 0
+	}
+
+	[ "$(sed '/^interface=/,$d' "$conf")" = "$(sed '/^interface=/,$d' "$conf.new")" ] && \
+	[ "$(grep -E "$bss_lines" "$conf")" = "$(grep -E "$bss_lines" "$conf.new")" ] || {
+		mv "$conf.new" "$conf"
+		return 1
+	}
+
+	mv "$conf" "$conf.old"
+	mv "$conf.new" "$conf"
+	for ifname in $(grep -E '^(interface|bss)=' "$conf" | cut -d= -f2); do
+		[ "$(mac80211_hostapd_bss_conf "$conf.old" "$ifname")" = \
+		  "$(mac80211_hostapd_bss_conf "$conf" "$ifname")" ] && continue
+		ubus call "hostapd.$ifname" reload || {
+			rm -f "$conf.old"
+			return 1
+		}
+	done
+	rm -f "$conf.old"
+
+	return 0
+}
+
 mac80211_iw_interface_add() {
 	local phy="$1"
 	local ifname="$2"
@@ -479,7 +540,7 @@ mac80211_prepare_vif() {
 			mac80211_hostapd_setup_bss "$phy" "$ifname" "$macaddr" "$type" || return
 
 			[ -n "$hostapd_ctrl" ] || {
-				mac80211_iw_interface_add "$phy" "$ifname" __ap || return
+				ap_ifname="$ifname"
 				hostapd_ctrl="${hostapd_ctrl:-/var/run/hostapd/$ifname}"
 			}
 		;;
@@ -730,7 +791,7 @@ drv_mac80211_setup() {
 		country chanbw distance \
 		txpower antenna_gain \
 		rxantenna txantenna \
-		frag rts beacon_int:100 htmode
+		frag rts beacon_int:100 htmode reconf
 	json_get_values basic_rate_list basic_rate
 	json_select ..
 
@@ -740,8 +801,50 @@ drv_mac80211_setup() {
 		return 1
 	}
 
-	wireless_set_data phy="$phy"
-	mac80211_interface_cleanup "$phy"
+	set_default rxantenna all
+	set_default txantenna all
+	set_default distance 0
+	set_default antenna_gain 0
+
+	# With reconf set, netifd runs the setup again instead of tearing the
+	# radio down when its config changes. The data of the previous run is
+	# then still there.
+	running_phy=
+	json_get_type data_type data
+	[ "$data_type" = object ] && {
+		json_select data
+		json_get_var running_phy phy
+		json_get_var running_antenna antenna
+		json_get_var running_chanbw chanbw
+		json_select ..
+	}
+
+	wireless_set_data phy="$phy" antenna="$txantenna $rxantenna" chanbw="$chanbw"
+
+	hostapd_conf_file="/var/run/hostapd-$phy.conf"
+
+	has_ap=
+	has_other=
+	for_each_interface "ap" mac80211_check_ap
+	for_each_interface "sta adhoc mesh monitor" mac80211_check_other
+
+	# A radio with only access points whose radio settings are unchanged is
+	# updated through its running hostapd, anything else is restarted from
+	# here. netifd no longer requires the processes of the previous run, so
+	# their exit is not treated as a failure.
+	hostapd_pid=
+	[ "${reconf:-0}" -gt 0 -a -n "$running_phy" ] && {
+		[ -n "$has_ap" -a -z "$has_other" -a "$running_phy" = "$phy" ] && \
+		[ "$running_antenna" = "$txantenna $rxantenna" -a "$running_chanbw" = "$chanbw" ] && \
+			hostapd_pid="$(mac80211_hostapd_running "$phy")"
+		[ -n "$hostapd_pid" ] || wireless_process_kill_all
+	}
+
+	if [ -n "$hostapd_pid" ]; then
+		hostapd_conf_file="$hostapd_conf_file.new"
+	else
+		mac80211_interface_cleanup "$phy"
+	fi
 
 	# convert channel to frequency
 	[ "$auto_channel" -gt 0 ] || freq="$(get_freq "$phy" "$channel")"
@@ -753,33 +856,28 @@ drv_mac80211_setup() {
 		}
 	}
 
-	hostapd_conf_file="/var/run/hostapd-$phy.conf"
-
 	no_ap=1
 	macidx=0
 	staidx=0
 
-	[ -n "$chanbw" ] && {
-		for file in /sys/kernel/debug/ieee80211/$phy/ath9k/chanbw /sys/kernel/debug/ieee80211/$phy/ath5k/bwmode; do
-			[ -f "$file" ] && echo "$chanbw" > "$file"
-		done
-	}
-
-	set_default rxantenna all
-	set_default txantenna all
-	set_default distance 0
-	set_default antenna_gain 0
+	# both only change while the interfaces are down
+	[ -z "$hostapd_pid" ] && {
+		[ -n "$chanbw" ] && {
+			for file in /sys/kernel/debug/ieee80211/$phy/ath9k/chanbw /sys/kernel/debug/ieee80211/$phy/ath5k/bwmode; do
+				[ -f "$file" ] && echo "$chanbw" > "$file"
+			done
+		}
 
-	iw phy "$phy" set antenna $txantenna $rxantenna >/dev/null 2>&1
+		iw phy "$phy" set antenna $txantenna $rxantenna >/dev/null 2>&1
+	}
 	iw phy "$phy" set antenna_gain $antenna_gain
 	iw phy "$phy" set distance "$distance"
 
 	[ -n "$frag" ] && iw phy "$phy" set frag "${frag%%.*}"
 	[ -n "$rts" ] && iw phy "$phy" set rts "${rts%%.*}"
 
-	has_ap=
 	hostapd_ctrl=
-	for_each_interface "ap" mac80211_check_ap
+	ap_ifname=
 
 	rm -f "$hostapd_conf_file"
 	[ -n "$has_ap" ] && mac80211_hostapd_setup_base "$phy"
@@ -787,7 +885,19 @@ drv_mac80211_setup() {
 	for_each_interface "sta adhoc mesh monitor" mac80211_prepare_vif
 	for_each_interface "ap" mac80211_prepare_vif
 
-	[ -n "$hostapd_ctrl" ] && {
+	[ -n "$hostapd_pid" ] && {
+		hostapd_conf_file="/var/run/hostapd-$phy.conf"
+		if mac80211_hostapd_reload; then
+			wireless_add_process "$hostapd_pid" "/usr/sbin/hostapd" 1
+		else
+			wireless_process_kill_all
+			mac80211_interface_cleanup "$phy"
+			hostapd_pid=
+		fi
+	}
+
+	[ -n "$hostapd_ctrl" -a -z "$hostapd_pid" ] && {
+		mac80211_iw_interface_add "$phy" "$ap_ifname" __ap || return
 		/usr/sbin/hostapd -s -P /var/run/wifi-$phy.pid -B "$hostapd_conf_file"
 		ret="$?"
 		wireless_add_process "$(cat /var/run/wifi-$phy.pid)" "/usr/sbin/hostapd" 1
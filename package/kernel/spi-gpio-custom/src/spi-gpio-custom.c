@@ -47,12 +47,20 @@
  *	spi-gpio-custom.bus1
  *	spi-gpio-custom.bus2
  *	spi-gpio-custom.bus3
+ *
+ *  When the calibrate parameter is set, the cost of a GPIO write on the
+ *  SCK pin is measured before the bus is registered. The clock which can
+ *  really be reached by bit-banging is derived from it, and the maxfreq
+ *  of the slaves is limited to that value. The results are shown in the
+ *  gpio_op_ns, clock_hz and throughput (bytes/s) attributes of the
+ *  spi_gpio platform device.
  */
 
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/platform_device.h>
+#include <linux/ktime.h>
 
 #include <linux/gpio.h>
 #include <linux/spi/spi.h>
@@ -78,6 +86,10 @@
 #define BUS_PARAM_COUNT		(4+BUS_PARAM_PER_SLAVE*BUS_SLAVE_COUNT_MAX)
 #define BUS_COUNT_MAX		4
 
+#define CALIB_LOOPS		1000
+/* GPIO accesses per bit: SCK low and high, MOSI write, MISO read */
+#define CALIB_OPS_PER_BIT	4
+
 static unsigned int bus0[BUS_PARAM_COUNT] __initdata;
 static unsigned int bus1[BUS_PARAM_COUNT] __initdata;
 static unsigned int bus2[BUS_PARAM_COUNT] __initdata;
@@ -97,9 +109,83 @@ MODULE_PARM_DESC(bus2, "bus2" BUS_PARM_DESC);
 module_param_array(bus3, uint, &bus_nump[3], 0);
 MODULE_PARM_DESC(bus3, "bus3" BUS_PARM_DESC);
 
+static bool calibrate;
+module_param(calibrate, bool, 0);
+MODULE_PARM_DESC(calibrate, "measure the achievable clock at probe time");
+
 static struct platform_device *devices[BUS_COUNT_MAX];
 static unsigned int nr_devices;
 
+static struct {
+	int id;
+	unsigned int op_ns;
+	unsigned int clock_hz;
+} calib[BUS_COUNT_MAX];
+
+/* the attributes exist as soon as the device is added, look up by bus id */
+static int spi_gpio_custom_index(struct device *dev)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(calib); i++)
+		if (calib[i].clock_hz && calib[i].id == to_platform_device(dev)->id)
+			return i;
+
+	return -ENODEV;
+}
+
+static ssize_t gpio_op_ns_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	int i = spi_gpio_custom_index(dev);
+
+	if (i < 0)
+		return i;
+
+	return sprintf(buf, "%u\n", calib[i].op_ns);
+}
+static DEVICE_ATTR_RO(gpio_op_ns);
+
+static ssize_t clock_hz_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	int i = spi_gpio_custom_index(dev);
+
+	if (i < 0)
+		return i;
+
+	return sprintf(buf, "%u\n", calib[i].clock_hz);
+}
+static DEVICE_ATTR_RO(clock_hz);
+
+static ssize_t throughput_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	int i = spi_gpio_custom_index(dev);
+
+	if (i < 0)
+		return i;
+
+	return sprintf(buf, "%u\n", calib[i].clock_hz / 8);
+}
+static DEVICE_ATTR_RO(throughput);
+
+static struct attribute *spi_gpio_custom_attrs[] = {
+	&dev_attr_gpio_op_ns.attr,
+	&dev_attr_clock_hz.attr,
+	&dev_attr_throughput.attr,
+	NULL,
+};
+
+static const struct attribute_group spi_gpio_custom_group = {
+	.attrs = spi_gpio_custom_attrs,
+};
+
+static const struct attribute_group *spi_gpio_custom_groups[] = {
+	&spi_gpio_custom_group,
+	NULL,
+};
+
 static void spi_gpio_custom_cleanup(void)
 {
 	int i;
@@ -148,6 +234,29 @@ static int __init spi_gpio_custom_get_slave_cs(unsigned int id,
 	return params[param_index];
 }
 
+/*
+ * Measure the cost of a GPIO write on the SCK pin. The pin is driven to
+ * the level spi_gpio initializes it to, so the slaves see no edge.
+ */
+static unsigned int __init spi_gpio_custom_calibrate(unsigned int pin)
+{
+	ktime_t start;
+	u64 ns;
+	int i;
+
+	if (gpio_request_one(pin, GPIOF_OUT_INIT_LOW, DRV_NAME))
+		return 0;
+
+	start = ktime_get();
+	for (i = 0; i < CALIB_LOOPS; i++)
+		gpio_set_value(pin, 0);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	gpio_free(pin);
+
+	return max_t(u64, div_u64(ns, CALIB_LOOPS), 1);
+}
+
 static int __init spi_gpio_custom_check_params(unsigned int id, unsigned int *params)
 {
 	int i;
@@ -211,6 +320,19 @@ static int __init spi_gpio_custom_add_one(unsigned int id, unsigned int *params)
 	if (err)
 		goto err;
 
+	memset(&calib[nr_devices], 0, sizeof(calib[nr_devices]));
+	calib[nr_devices].id = params[BUS_PARAM_ID];
+	if (calibrate) {
+		calib[nr_devices].op_ns =
+			spi_gpio_custom_calibrate(params[BUS_PARAM_SCK]);
+		if (calib[nr_devices].op_ns)
+			calib[nr_devices].clock_hz = NSEC_PER_SEC /
+				(CALIB_OPS_PER_BIT * calib[nr_devices].op_ns);
+		printk(KERN_INFO PFX "bus %d: %u ns per GPIO write, up to %u Hz\n",
+		       params[BUS_PARAM_ID], calib[nr_devices].op_ns,
+		       calib[nr_devices].clock_hz);
+	}
+
 	/* Create BUS device node */
 
 	pdev = platform_device_alloc("spi_gpio", params[BUS_PARAM_ID]);
@@ -251,6 +373,9 @@ static int __init spi_gpio_custom_add_one(unsigned int id, unsigned int *params)
 		goto err;
 	}
 
+	if (calib[nr_devices].clock_hz)
+		pdev->dev.groups = spi_gpio_custom_groups;
+
 	err = platform_device_add(pdev);
 	if (err) {
 		printk(KERN_ERR PFX "platform_device_add failed with return code %d\n",
@@ -270,6 +395,10 @@ static int __init spi_gpio_custom_add_one(unsigned int id, unsigned int *params)
 		if (mode < 0)
 			break;
 
+		if (calib[nr_devices].clock_hz &&
+		    maxfreq > calib[nr_devices].clock_hz)
+			maxfreq = calib[nr_devices].clock_hz;
+
 		memset(&slave_info, 0, sizeof(slave_info));
 		strcpy(slave_info.modalias, "spidev");
 		slave_info.controller_data = (void *)((cs >= 0)
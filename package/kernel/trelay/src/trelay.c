@@ -19,33 +19,68 @@
 #include <linux/netdevice.h>
 #include <linux/rtnetlink.h>
 #include <linux/debugfs.h>
+#include <linux/u64_stats_sync.h>
 
 static LIST_HEAD(trelay_devs);
 static struct dentry *debugfs_dir;
 
+struct trelay_stats {
+	u64 packets;
+	u64 bytes;
+	u64 dropped;
+	struct u64_stats_sync syncp;
+};
+
+/* one direction of a relay: frames received on one device go out on dev */
+struct trelay_dir {
+	struct net_device *dev;
+	struct trelay_stats __percpu *stats;
+};
+
 struct trelay {
 	struct list_head list;
 	struct net_device *dev1, *dev2;
+	struct trelay_dir dir[2];
 	struct dentry *debugfs;
 	char name[];
 };
 
 rx_handler_result_t trelay_handle_frame(struct sk_buff **pskb)
 {
+	struct trelay_dir *dir;
+	struct trelay_stats *stats;
 	struct net_device *dev;
 	struct sk_buff *skb = *pskb;
+	unsigned int len, segs, dropped = 0;
 
-	dev = rcu_dereference(skb->dev->rx_handler_data);
-	if (!dev)
+	dir = rcu_dereference(skb->dev->rx_handler_data);
+	if (!dir)
 		return RX_HANDLER_PASS;
 
 	if (skb->protocol == htons(ETH_P_PAE))
 		return RX_HANDLER_PASS;
 
+	dev = dir->dev;
 	skb_push(skb, ETH_HLEN);
 	skb->dev = dev;
 	skb_forward_csum(skb);
-	dev_queue_xmit(skb);
+
+	len = skb->len;
+	segs = skb_is_gso(skb) ? skb_shinfo(skb)->gso_segs : 1;
+
+	/*
+	 * A GRO merged frame is segmented by dev_queue_xmit, which hands the
+	 * segments to the driver as one batch with xmit_more set
+	 */
+	if (net_xmit_eval(dev_queue_xmit(skb)))
+		dropped = segs;
+
+	stats = this_cpu_ptr(dir->stats);
+	u64_stats_update_begin(&stats->syncp);
+	stats->packets += segs;
+	stats->bytes += len;
+	stats->dropped += dropped;
+	u64_stats_update_end(&stats->syncp);
 
 	return RX_HANDLER_CONSUMED;
 }
@@ -67,6 +102,8 @@ static int trelay_do_remove(struct trelay *tr)
 	netdev_rx_handler_unregister(tr->dev2);
 
 	debugfs_remove_recursive(tr->debugfs);
+	free_percpu(tr->dir[0].stats);
+	free_percpu(tr->dir[1].stats);
 	kfree(tr);
 
 	return 0;
@@ -125,6 +162,52 @@ static const struct file_operations fops_remove = {
 	.llseek = default_llseek,
 };
 
+static ssize_t trelay_stats_read(struct file *file, char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	struct trelay *tr = file->private_data;
+	char buf[256];
+	int i, cpu, len = 0;
+
+	for (i = 0; i < ARRAY_SIZE(tr->dir); i++) {
+		struct trelay_dir *dir = &tr->dir[i];
+		u64 packets = 0, bytes = 0, dropped = 0;
+
+		for_each_possible_cpu(cpu) {
+			const struct trelay_stats *stats;
+			u64 p, b, d;
+			unsigned int start;
+
+			stats = per_cpu_ptr(dir->stats, cpu);
+			do {
+				start = u64_stats_fetch_begin_irq(&stats->syncp);
+				p = stats->packets;
+				b = stats->bytes;
+				d = stats->dropped;
+			} while (u64_stats_fetch_retry_irq(&stats->syncp, start));
+
+			packets += p;
+			bytes += b;
+			dropped += d;
+		}
+
+		/* the other direction transmits on our receiving device */
+		len += scnprintf(buf + len, sizeof(buf) - len,
+				 "%s -> %s: packets %llu bytes %llu dropped %llu\n",
+				 tr->dir[!i].dev->name, dir->dev->name,
+				 packets, bytes, dropped);
+	}
+
+	return simple_read_from_buffer(ubuf, count, ppos, buf, len);
+}
+
+static const struct file_operations fops_stats = {
+	.owner = THIS_MODULE,
+	.open = trelay_open,
+	.read = trelay_stats_read,
+	.llseek = default_llseek,
+};
+
 
 static int trelay_do_add(char *name, char *devn1, char *devn2)
 {
@@ -136,6 +219,15 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 	if (!tr)
 		return -ENOMEM;
 
+	tr->dir[0].stats = netdev_alloc_pcpu_stats(struct trelay_stats);
+	tr->dir[1].stats = netdev_alloc_pcpu_stats(struct trelay_stats);
+	if (!tr->dir[0].stats || !tr->dir[1].stats) {
+		free_percpu(tr->dir[0].stats);
+		free_percpu(tr->dir[1].stats);
+		kfree(tr);
+		return -ENOMEM;
+	}
+
 	rtnl_lock();
 	rcu_read_lock();
 
@@ -151,11 +243,14 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 	if (!dev1 || !dev2)
 		goto out;
 
-	ret = netdev_rx_handler_register(dev1, trelay_handle_frame, dev2);
+	tr->dir[0].dev = dev2;
+	tr->dir[1].dev = dev1;
+
+	ret = netdev_rx_handler_register(dev1, trelay_handle_frame, &tr->dir[0]);
 	if (ret < 0)
 		goto out;
 
-	ret = netdev_rx_handler_register(dev2, trelay_handle_frame, dev1);
+	ret = netdev_rx_handler_register(dev2, trelay_handle_frame, &tr->dir[1]);
 	if (ret < 0) {
 		netdev_rx_handler_unregister(dev1);
 		goto out;
@@ -171,13 +266,17 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 
 	tr->debugfs = debugfs_create_dir(name, debugfs_dir);
 	debugfs_create_file("remove", S_IWUSR, tr->debugfs, tr, &fops_remove);
+	debugfs_create_file("stats", S_IRUSR, tr->debugfs, tr, &fops_stats);
 	ret = 0;
 
 out:
 	rcu_read_unlock();
 	rtnl_unlock();
-	if (ret < 0)
+	if (ret < 0) {
+		free_percpu(tr->dir[0].stats);
+		free_percpu(tr->dir[1].stats);
 		kfree(tr);
+	}
 
 	return ret;
 }
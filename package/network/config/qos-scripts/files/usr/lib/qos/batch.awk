@@ -0,0 +1,49 @@
+# Turns the command list produced by generate.sh into a script which
+# installs all tc objects with a single tc -batch call and all mangle
+# rules of each address family with a single iptables-restore commit.
+# iptables-restore does not take the xtables lock itself, so it is run
+# under flock on the lock file of "iptables -w", /run/xtables.lock
+# (XT_LOCK_NAME, not overridden by the iptables package). Without /run
+# iptables cannot create its lock file either, and nothing is locked.
+# Module loads, ifconfig and the (possibly failing) deletions are kept
+# as separate commands and run first.
+
+{
+	sub(/^[ \t]+/, "")
+}
+
+/^$/ { next }
+
+/^ip6?tables -w -t mangle / {
+	fam = $1
+	if (!(fam in ipt)) order[nfam++] = fam
+	sub(/^ip6?tables -w -t mangle /, "")
+	ipt[fam] = ipt[fam] $0 "\n"
+	next
+}
+
+/^tc / && !/ del / {
+	sub(/^tc /, "")
+	tcb = tcb $0 "\n"
+	next
+}
+
+{ print }
+
+END {
+	if (tcb != "") {
+		print "tc -force -batch - <<'QOS_TC'"
+		printf "%s", tcb
+		print "QOS_TC"
+	}
+	if (nfam > 0)
+		print "QOS_LOCK=; [ -d /run ] && QOS_LOCK=\"flock /run/xtables.lock\""
+	for (i = 0; i < nfam; i++) {
+		fam = order[i]
+		print "$QOS_LOCK " fam "-restore --noflush <<'QOS_IPT'"
+		print "*mangle"
+		printf "%s", ipt[fam]
+		print "COMMIT"
+		print "QOS_IPT"
+	}
+}
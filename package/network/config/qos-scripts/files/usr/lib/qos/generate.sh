@@ -115,7 +115,7 @@ parse_matching_rule() {
 			;;
 			*:comment)
 				add_insmod xt_comment
-				append "$var" "-m comment --comment '$value'"
+				append "$var" "-m comment --comment \"$value\""
 			;;
 			*:tos)
                                 add_insmod xt_dscp
@@ -272,9 +272,55 @@ tcrules() {
 		-v device="$dev" \
 		-v linespeed="$rate" \
 		-v direction="$dir" \
+		-v classifier="$classifier" \
 		-f $_dir/tcrules.awk
 }
 
+filter_rules() {
+	local rule option value entry class maxsize
+	for rule in $rules $ctrules; do
+		config_get class "$rule" target
+		config_get target "$class" classnr
+		[ -z "$target" ] && continue
+		config_get type "$rule" TYPE
+		config_get options "$rule" options
+		entry="$rule $type $target"
+		# see the maxsize rules in start_cg
+		config_get maxsize "$class" maxsize
+		[ "$type" = classify -a -n "$maxsize" ] && append entry "maxsize=$maxsize"
+		for option in $options; do
+			config_get value "$rule" "$option"
+			[ -z "$value" ] && continue
+			case "$option" in
+				target|comment) ;;
+				proto|srchost|dsthost|ports|srcports|dstports|portrange|pktsize|dscp|tos)
+					append entry "$option=$value"
+				;;
+				*)
+					echo "qos: rule $rule: option $option is not supported by the tc classifier, skipped" >&2
+					continue 2
+				;;
+			esac
+		done
+		echo "$entry"
+	done
+}
+
+tcfilters() {
+	_dir=/usr/lib/qos
+	[ -e $_dir/tcfilters.awk ] || _dir=.
+	filter_rules | awk \
+		-v device="$dev" \
+		-v direction="$dir" \
+		-f $_dir/tcfilters.awk
+}
+
+batch() {
+	_dir=/usr/lib/qos
+	[ -e $_dir/batch.awk ] || _dir=.
+	awk -f $_dir/batch.awk
+}
+
 start_interface() {
 	local iface="$1"
 	local num_ifb="$2"
@@ -288,6 +334,7 @@ start_interface() {
 	config_get download "$iface" download
 	config_get classgroup "$iface" classgroup
 	config_get_bool overhead "$iface" overhead 0
+	config_get classifier "$iface" classifier iptables
 	
 	download="${download:-${halfduplex:+$upload}}"
 	enum_classes "$classgroup"
@@ -324,6 +371,7 @@ start_interface() {
 			append cstr "$classnr:$prio:$avgrate:$pktsize:$pktdelay:$maxrate:$qdisc:$filter" "$N"
 		done
 		append ${prefix}q "$(tcrules)" "$N"
+		[ "$classifier" = tc ] && append ${prefix}q "$(tcfilters)" "$N"
 		export dev_${dir}="ifconfig $dev up >&- 2>&-
 tc qdisc del dev $dev root >&- 2>&-
 tc qdisc add dev $dev root handle 1: hfsc default ${class_default}0
@@ -332,10 +380,17 @@ tc class add dev $dev parent 1: classid 1:1 hfsc sc rate ${rate}kbit ul rate ${r
 	[ -n "$download" ] && {
 		add_insmod cls_u32
 		add_insmod em_u32
-		add_insmod act_connmark
+		[ "$classifier" = tc ] || add_insmod act_connmark
 		add_insmod act_mirred
 		add_insmod sch_ingress
 	}
+	[ "$classifier" = tc ] && {
+		connmark=
+		add_insmod cls_u32
+	} || {
+		connmark="action connmark "
+		add_insmod cls_fw
+	}
 	if [ -n "$halfduplex" ]; then
 		export dev_up="tc qdisc del dev $device root >&- 2>&-
 tc qdisc add dev $device root handle 1: hfsc
@@ -343,9 +398,8 @@ tc filter add dev $device parent 1: prio 10 u32 match u32 0 0 flowid 1:1 action
 	elif [ -n "$download" ]; then
 		append dev_${dir} "tc qdisc del dev $device ingress >&- 2>&-
 tc qdisc add dev $device ingress
-tc filter add dev $device parent ffff: prio 1 u32 match u32 0 0 flowid 1:1 action connmark action mirred egress redirect dev ifb$ifbdev" "$N"
+tc filter add dev $device parent ffff: prio 1 u32 match u32 0 0 flowid 1:1 ${connmark}action mirred egress redirect dev ifb$ifbdev" "$N"
 	fi
-	add_insmod cls_fw
 	add_insmod sch_hfsc
 
 	cat <<EOF
@@ -423,7 +477,10 @@ start_cg() {
 		config_get upload "$iface" upload
 		config_get download "$iface" download
 		config_get halfduplex "$iface" halfduplex
+		config_get classifier "$iface" classifier iptables
 		download="${download:-${halfduplex:+$upload}}"
+		# classified by u32 filters on the qdisc, see tcfilters.awk
+		[ "$classifier" = tc ] && continue
 		for command in $iptables; do
 			append up "$command -w -t mangle -A OUTPUT -o $device -j qos_${cg}" "$N"
 			append up "$command -w -t mangle -A FORWARD -o $device -j qos_${cg}" "$N"
@@ -513,7 +570,7 @@ done
 	iptables="iptables"
 }
 
-case "$1" in
+{ case "$1" in
 	all)
 		start_interfaces "$C"
 		start_firewall
@@ -534,4 +591,4 @@ case "$1" in
 			;;
 		esac
 	;;
-esac
+esac; } | batch
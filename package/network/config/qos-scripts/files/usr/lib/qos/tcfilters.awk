@@ -0,0 +1,261 @@
+# Compiles the classify/default/reclassify rules into u32 filters on the
+# hfsc root qdisc, so that packets are classified without walking the
+# iptables mangle chains.
+#
+# Input: one rule per line, "<section> <type> <classnr> [option=value]..."
+# The maxsize of the target class is passed along with classify rules.
+# Filter priorities follow the effective iptables result: reclassify rules
+# override everything, classify rules override defaults. Connection
+# tracking is not involved, so classify rules apply to each packet.
+#
+# Ports are matched with "match ip/ip6 sport/dport", i.e. at the fixed
+# offsets 20 and 40. Unlike "-m multiport" they do not see the ports of
+# IPv4 packets with options or of IPv6 packets with extension headers,
+# such packets fall through to the later rules.
+
+function warn(msg) {
+	print "qos: rule " rule ": " msg ", skipped" > "/dev/stderr"
+	skip = 1
+}
+
+# Port matches are compiled, tell about their limits once
+function portnote() {
+	if (noted) return
+	print "qos: the tc classifier matches ports only in IPv4 packets without options and IPv6 packets without extension headers" > "/dev/stderr"
+	noted = 1
+}
+
+function addalt(s) {
+	alt[++nalt] = s
+}
+
+# Combine every filter built so far with every alternative in alt[]
+function product(i, j, n) {
+	if (nalt == 0) return
+	n = 0
+	split("", tmp)
+	for (i = 1; i <= ncombo; i++)
+		for (j = 1; j <= nalt; j++)
+			tmp[++n] = combo[i] " " alt[j]
+	for (i = 1; i <= n; i++)
+		combo[i] = tmp[i]
+	ncombo = n
+	nalt = 0
+}
+
+# Split port or length ranges into value/mask pairs
+function ranges(spec, prefix, suffix, width, adj, items, b, n, i, lo, hi, size) {
+	n = split(spec, items, ",")
+	for (i = 1; i <= n; i++) {
+		if (items[i] ~ /[-:]/) {
+			split(items[i], b, /[-:]/)
+			lo = b[1]
+			hi = b[2]
+		} else {
+			lo = items[i]
+			hi = items[i]
+		}
+		if (lo == "") lo = 0
+		if (hi == "") hi = 2^width - 1
+		lo -= adj
+		hi -= adj
+		if (lo < 0) lo = 0
+		while (lo <= hi) {
+			size = 1
+			while ((lo % (size * 2) == 0) && (lo + size * 2 - 1 <= hi))
+				size *= 2
+			addalt(prefix sprintf(" 0x%x 0x%x", lo, 2^width - size) suffix)
+			lo += size
+		}
+	}
+}
+
+# Match the packet length like "-m length": IPv4 total length, IPv6
+# payload length plus the 40 byte header
+function lengths(fam, spec) {
+	if (fam == "ip") ranges(spec, "match u16", " at 2", 16, 0)
+	else ranges(spec, "match u16", " at 4", 16, 40)
+}
+
+function protonum(p) {
+	if (p ~ /^[0-9]+$/) return p
+	if (p in protos) return protos[p]
+	warn("unknown protocol " p)
+	return ""
+}
+
+function dscpval(v) {
+	if (v ~ /^CS[0-7]$/) return substr(v, 3) * 8
+	if (v ~ /^AF[1-4][1-3]$/) return substr(v, 3, 1) * 8 + substr(v, 4, 1) * 2
+	if (v == "EF") return 46
+	if (v ~ /^0x/) return hex(v)
+	if (v ~ /^[0-9]+$/) return v + 0
+	warn("unknown DSCP value " v)
+	return 0
+}
+
+function hex(v, i, n) {
+	v = tolower(substr(v, 3))
+	n = 0
+	for (i = 1; i <= length(v); i++)
+		n = n * 16 + index("0123456789abcdef", substr(v, i, 1)) - 1
+	return n
+}
+
+# Emit the filters of the current rule for one address family
+function compile(fam, m, p, proto, ports, i) {
+	if (opt["family"] != "" && opt["family"] != fam)
+		return
+
+	ncombo = 1
+	combo[1] = ""
+	nalt = 0
+
+	proto = opt["proto"]
+	ports = (opt["ports"] != "" || opt["sports"] != "" || opt["dports"] != "" || opt["portrange"] != "")
+	if (ports) portnote()
+	# like the iptables rules, ports without a protocol mean TCP
+	if (proto == "" && ports) {
+		addalt("match " fam " protocol 6 0xff")
+	} else if (proto != "" && proto != "all") {
+		p = protonum(proto)
+		if (fam == "ip6" && p == 1) return
+		if (fam == "ip" && p == 58) return
+		addalt("match " fam " protocol " p " 0xff")
+	}
+	product()
+
+	if (opt["src"] != "") {
+		addalt("match " fam " src " opt["src"])
+		product()
+	}
+	if (opt["dst"] != "") {
+		addalt("match " fam " dst " opt["dst"])
+		product()
+	}
+	if (opt["ports"] != "") {
+		ranges(opt["ports"], "match " fam " sport", "", 16, 0)
+		ranges(opt["ports"], "match " fam " dport", "", 16, 0)
+		product()
+	}
+	if (opt["sports"] != "") {
+		ranges(opt["sports"], "match " fam " sport", "", 16, 0)
+		product()
+	}
+	if (opt["dports"] != "") {
+		ranges(opt["dports"], "match " fam " dport", "", 16, 0)
+		product()
+	}
+	if (opt["portrange"] != "") {
+		ranges(opt["portrange"], "match " fam " sport", "", 16, 0)
+		product()
+		ranges(opt["portrange"], "match " fam " dport", "", 16, 0)
+		product()
+	}
+	if (opt["pktsize"] != "") {
+		lengths(fam, opt["pktsize"])
+		if (nalt == 0) return
+		product()
+	}
+	# packets of the class above its maxsize are left to the later rules
+	if (opt["maxsize"] != "") {
+		lengths(fam, "0-" (opt["maxsize"] - 1))
+		if (nalt == 0) return
+		product()
+	}
+	if (opt["dscp"] != "") {
+		addalt(sprintf("match %s %s 0x%02x 0xfc", fam, (fam == "ip" ? "dsfield" : "priority"), opt["dscp"] * 4))
+		product()
+	}
+	if (opt["tos"] != "") {
+		addalt(sprintf("match %s %s %s", fam, (fam == "ip" ? "tos" : "priority"), opt["tos"]))
+		product()
+	}
+	if (skip) return
+
+	filters = ""
+	for (i = 1; i <= ncombo; i++) {
+		m = combo[i]
+		if (m ~ /^ *$/) m = "match u32 0 0 at 0"
+		filters = filters sprintf("tc filter add dev %s parent 1: protocol %s prio %%d u32%s flowid 1:%d0\n", device, (fam == "ip" ? "ip" : "ipv6"), m, class)
+	}
+	# the last matching reclassify rule wins, for the others the first one
+	if (pass == 1) out[pass] = filters out[pass]
+	else out[pass] = out[pass] filters
+}
+
+BEGIN {
+	protos["icmp"] = 1
+	protos["tcp"] = 6
+	protos["udp"] = 17
+	protos["gre"] = 47
+	protos["esp"] = 50
+	protos["ah"] = 51
+	protos["icmpv6"] = 58
+	protos["ipv6-icmp"] = 58
+	protos["sctp"] = 132
+
+	tos["Minimize-Delay"] = "0x10 0x3f"
+	tos["Maximize-Throughput"] = "0x08 0x3f"
+	tos["Maximize-Reliability"] = "0x04 0x3f"
+	tos["Minimize-Cost"] = "0x02 0x3f"
+	tos["Normal-Service"] = "0x00 0x3f"
+
+	order["reclassify"] = 1
+	order["classify"] = 2
+	order["default"] = 3
+}
+
+($1 != "") {
+	rule = $1
+	pass = order[$2]
+	class = $3
+	skip = 0
+	split("", opt)
+	for (f = 4; f <= NF; f++) {
+		key = substr($f, 1, index($f, "=") - 1)
+		val = substr($f, index($f, "=") + 1)
+		if (val ~ /^!/) {
+			warn("negated " key " is not supported by the tc classifier")
+			continue
+		}
+		# the download side sees the replies, so swap the endpoints
+		if (direction == "down") {
+			if (key == "srchost") key = "dsthost"
+			else if (key == "dsthost") key = "srchost"
+			else if (key == "srcports") key = "dstports"
+			else if (key == "dstports") key = "srcports"
+		}
+		if (key == "srchost" || key == "dsthost") {
+			if (val ~ /^[0-9.]+(\/[0-9]+)?$/) fam = "ip"
+			else if (val ~ /^[0-9a-fA-F:]+(\/[0-9]+)?$/) fam = "ip6"
+			else warn("host " val " is not an address")
+			if (opt["family"] != "" && opt["family"] != fam)
+				warn("mixed address families")
+			opt["family"] = fam
+			opt[key == "srchost" ? "src" : "dst"] = val
+		} else if (key == "srcports") opt["sports"] = val
+		else if (key == "dstports") opt["dports"] = val
+		else if (key == "dscp") opt["dscp"] = dscpval(val)
+		else if (key == "tos") {
+			if (val in tos) opt["tos"] = tos[val]
+			else if (val ~ /\//) opt["tos"] = substr(val, 1, index(val, "/") - 1) " " substr(val, index(val, "/") + 1)
+			else opt["tos"] = val " 0xff"
+		} else opt[key] = val
+	}
+	if (skip) next
+	compile("ip")
+	compile("ip6")
+}
+
+END {
+	prio = 100
+	for (pass = 1; pass <= 3; pass++) {
+		n = split(out[pass], lines, "\n")
+		for (i = 1; i <= n; i++) {
+			if (lines[i] == "") continue
+			printf lines[i] "\n", (lines[i] ~ /protocol ipv6/ ? prio + 1 : prio)
+		}
+		prio += 2
+	}
+}
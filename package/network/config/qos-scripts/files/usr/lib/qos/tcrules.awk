@@ -93,8 +93,11 @@ END {
 			filter_2 = sprintf("0x%x0/0xf0", class[i])
 		}
 
-		printf filter_cmd, class[i] * 2, filter_1, class[i]
-		printf filter_cmd, class[i] * 2 + 1, filter_2, class[i]
+		# with the tc classifier, tcfilters.awk replaces the fw mark filters
+		if (classifier != "tc") {
+			printf filter_cmd, class[i] * 2, filter_1, class[i]
+			printf filter_cmd, class[i] * 2 + 1, filter_2, class[i]
+		}
 
 		filterc=1
 		if (filter[i] != "") {
@@ -0,0 +1,461 @@
+/*
+ * dnsmasq-uci - emit the per-host parts of the dnsmasq configuration
+ *
+ * Walks /etc/config/dhcp once and appends the dnsmasq options for the
+ * host, domain, hostrecord, srvhost, mxhost and cname sections of one
+ * dnsmasq instance. This replaces the config_foreach loops of the init
+ * script, which fork several helpers per entry and get very slow with
+ * thousands of static leases. The output matches what the shell
+ * functions used to produce.
+ *
+ * Copyright (C) 2018 OpenWrt.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <uci.h>
+
+struct output {
+	FILE *conf;
+	FILE *hosts;
+	const char *instance;
+	const char *domain;
+	int dhcpv6;
+};
+
+struct strbuf {
+	char *data;
+	size_t len, size;
+};
+
+static void buf_add(struct strbuf *b, const char *str, size_t len)
+{
+	if (b->len + len + 1 > b->size) {
+		b->size = (b->len + len + 1) * 2;
+		b->data = realloc(b->data, b->size);
+		if (!b->data) {
+			perror("realloc");
+			exit(1);
+		}
+	}
+	memcpy(b->data + b->len, str, len);
+	b->len += len;
+	b->data[b->len] = 0;
+}
+
+static void buf_puts(struct strbuf *b, const char *str)
+{
+	buf_add(b, str, strlen(str));
+}
+
+static void buf_reset(struct strbuf *b)
+{
+	b->len = 0;
+	if (b->data)
+		b->data[0] = 0;
+}
+
+/* like config_get: lists are returned as space separated values */
+static const char *get(struct uci_section *s, const char *name)
+{
+	static struct strbuf val;
+	struct uci_option *o;
+	struct uci_element *e;
+
+	o = uci_lookup_option(s->package->ctx, s, name);
+	if (!o)
+		return NULL;
+
+	if (o->type == UCI_TYPE_STRING)
+		return *o->v.string ? o->v.string : NULL;
+
+	buf_reset(&val);
+	uci_foreach_element(&o->v.list, e) {
+		if (val.len)
+			buf_puts(&val, " ");
+		buf_puts(&val, e->name);
+	}
+
+	return val.len ? val.data : NULL;
+}
+
+static char *get_dup(struct uci_section *s, const char *name)
+{
+	const char *val = get(s, name);
+
+	return val ? strdup(val) : NULL;
+}
+
+/* like config_get_bool */
+static int get_bool(struct uci_section *s, const char *name, int def)
+{
+	const char *val = get(s, name);
+
+	if (!val)
+		return def;
+
+	if (!strcmp(val, "1") || !strcmp(val, "on") || !strcmp(val, "true") ||
+	    !strcmp(val, "yes") || !strcmp(val, "enabled"))
+		return 1;
+
+	if (!strcmp(val, "0") || !strcmp(val, "off") || !strcmp(val, "false") ||
+	    !strcmp(val, "no") || !strcmp(val, "disabled"))
+		return 0;
+
+	return def;
+}
+
+/* append the whitespace separated words of str, each preceded by sep */
+static void add_words(struct strbuf *b, const char *str, const char *sep)
+{
+	const char *end;
+
+	while (str && *str) {
+		while (isspace((unsigned char)*str))
+			str++;
+		if (!*str)
+			break;
+
+		for (end = str; *end && !isspace((unsigned char)*end); end++)
+			;
+
+		if (b->len)
+			buf_puts(b, sep);
+		buf_add(b, str, end - str);
+		str = end;
+	}
+}
+
+static int hex_to_hostid(char *out, size_t len, const char *hex)
+{
+	unsigned long long val;
+	char *end;
+
+	if (!strncmp(hex, "0x", 2))
+		hex += 2;
+
+	/* 64 bit like the shell arithmetic, also on 32 bit targets */
+	val = strtoull(hex, &end, 16);
+	if (*end)
+		return -1;
+
+	snprintf(out, len, "%llx:%llx", (val >> 16) % 65536, val % 65536);
+	return 0;
+}
+
+static void dhcp_option_add(struct output *out, struct uci_section *s,
+			    const char *networkid, int force)
+{
+	struct strbuf opts = {};
+	struct uci_option *o;
+	struct uci_element *e;
+	const char *p;
+
+	o = uci_lookup_option(s->package->ctx, s, "dhcp_option");
+	if (!o)
+		return;
+
+	if (o->type == UCI_TYPE_LIST) {
+		uci_foreach_element(&o->v.list, e)
+			fprintf(out->conf, "dhcp-option%s=%s%s%s\n",
+				force ? "-force" : "", networkid,
+				*networkid ? "," : "", e->name);
+		return;
+	}
+
+	if (!*o->v.string)
+		return;
+
+	fprintf(stderr, "Warning: the 'option dhcp_option' syntax is deprecated, use 'list dhcp_option'\n");
+
+	add_words(&opts, o->v.string, "\n");
+	for (p = strtok(opts.data, "\n"); p; p = strtok(NULL, "\n"))
+		fprintf(out->conf, "dhcp-option%s=%s%s%s\n",
+			force ? "-force" : "", networkid,
+			*networkid ? "," : "", p);
+	free(opts.data);
+}
+
+static void host_add(struct output *out, struct uci_section *s)
+{
+	struct strbuf line = {}, macs = {}, tags = {};
+	char *name, *ip, *hostid, *networkid, *duid, *leasetime;
+	char hostid_buf[16];
+	int force;
+
+	force = get_bool(s, "force", 0);
+	networkid = get_dup(s, "networkid");
+	if (networkid)
+		dhcp_option_add(out, s, networkid, force);
+
+	if (!get_bool(s, "enable", 1))
+		goto out;
+
+	name = get_dup(s, "name");
+	ip = get_dup(s, "ip");
+	hostid = get_dup(s, "hostid");
+
+	if (!ip && !name && !hostid)
+		goto out_free;
+
+	if (get_bool(s, "dns", 0) && ip && name)
+		fprintf(out->hosts, "%s %s%s%s\n", ip, name,
+			out->domain ? "." : "", out->domain ? out->domain : "");
+
+	/* many MAC are possible to track a laptop ON/OFF dock */
+	add_words(&macs, get(s, "mac"), ",");
+
+	duid = NULL;
+	if (out->dhcpv6 && (duid = get_dup(s, "duid")) != NULL)
+		duid[strcspn(duid, " ")] = 0;
+
+	if (!macs.len && !duid) {
+		if (!name)
+			goto out_free;
+
+		buf_puts(&macs, name);
+		free(name);
+		name = NULL;
+	}
+
+	if (hostid && !hex_to_hostid(hostid_buf, sizeof(hostid_buf), hostid)) {
+		free(hostid);
+		hostid = strdup(hostid_buf);
+	}
+
+	add_words(&tags, get(s, "tag"), ",set:");
+	leasetime = get_dup(s, "leasetime");
+
+	buf_puts(&line, "dhcp-host=");
+	if (macs.len)
+		buf_puts(&line, macs.data);
+	if (duid) {
+		buf_puts(&line, ",id:");
+		buf_puts(&line, duid);
+	}
+	if (networkid) {
+		buf_puts(&line, ",set:");
+		buf_puts(&line, networkid);
+	}
+	if (tags.len) {
+		buf_puts(&line, ",set:");
+		buf_puts(&line, tags.data);
+	}
+	if (get_bool(s, "broadcast", 0))
+		buf_puts(&line, ",set:needs-broadcast");
+	if (ip) {
+		buf_puts(&line, ",");
+		buf_puts(&line, ip);
+	}
+	if (out->dhcpv6 && hostid) {
+		buf_puts(&line, ",[::");
+		buf_puts(&line, hostid);
+		buf_puts(&line, "]");
+	}
+	if (name) {
+		buf_puts(&line, ",");
+		buf_puts(&line, name);
+	}
+	if (leasetime) {
+		buf_puts(&line, ",");
+		buf_puts(&line, leasetime);
+	}
+	fprintf(out->conf, "%s\n", line.data);
+
+	free(leasetime);
+	free(duid);
+	free(line.data);
+	free(tags.data);
+out_free:
+	free(macs.data);
+	free(name);
+	free(ip);
+	free(hostid);
+out:
+	free(networkid);
+}
+
+static void domain_add(struct output *out, struct uci_section *s)
+{
+	struct strbuf record = {};
+	const char *ip;
+
+	add_words(&record, get(s, "name"), " ");
+	ip = get(s, "ip");
+	if (record.len && ip)
+		fprintf(out->hosts, "%s %s\n", ip, record.data);
+
+	free(record.data);
+}
+
+static void hostrecord_add(struct output *out, struct uci_section *s)
+{
+	struct strbuf record = {};
+	const char *ip;
+
+	add_words(&record, get(s, "name"), ",");
+	ip = get(s, "ip");
+	if (record.len && ip) {
+		add_words(&record, ip, ",");
+		fprintf(out->conf, "host-record=%s\n", record.data);
+	}
+
+	free(record.data);
+}
+
+static void srv_add(struct output *out, struct uci_section *s)
+{
+	char *srv, *target, *port, *class;
+	const char *weight;
+
+	srv = get_dup(s, "srv");
+	target = get_dup(s, "target");
+	port = get_dup(s, "port");
+	class = get_dup(s, "class");
+	weight = get(s, "weight");
+
+	if (srv && target && port)
+		fprintf(out->conf, "srv-host=%s,%s,%s%s%s%s%s\n", srv, target, port,
+			class ? "," : "", class ? class : "",
+			class && weight ? "," : "", class && weight ? weight : "");
+
+	free(srv);
+	free(target);
+	free(port);
+	free(class);
+}
+
+static void mx_add(struct output *out, struct uci_section *s)
+{
+	char *domain, *relay;
+	const char *pref;
+
+	domain = get_dup(s, "domain");
+	relay = get_dup(s, "relay");
+	pref = get(s, "pref");
+
+	if (domain && relay)
+		fprintf(out->conf, "mx-host=%s,%s,%s\n", domain, relay,
+			pref ? pref : "0");
+
+	free(domain);
+	free(relay);
+}
+
+static void cname_add(struct output *out, struct uci_section *s)
+{
+	char *cname;
+	const char *target;
+
+	cname = get_dup(s, "cname");
+	target = get(s, "target");
+
+	if (cname && target)
+		fprintf(out->conf, "cname=%s,%s\n", cname, target);
+
+	free(cname);
+}
+
+static const struct {
+	const char *type;
+	void (*add)(struct output *out, struct uci_section *s);
+} handlers[] = {
+	{ "host", host_add },
+	{ "domain", domain_add },
+	{ "hostrecord", hostrecord_add },
+	{ "srvhost", srv_add },
+	{ "mxhost", mx_add },
+	{ "cname", cname_add },
+};
+
+static int usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [-6] [-d <domain>] <instance> <config file> <hosts file>\n", prog);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	struct output out = {};
+	struct uci_context *ctx;
+	struct uci_package *p = NULL;
+	struct uci_element *e;
+	struct uci_section *s;
+	const char *instance;
+	unsigned int i;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "6d:")) != -1) {
+		switch (ch) {
+		case '6':
+			out.dhcpv6 = 1;
+			break;
+		case 'd':
+			out.domain = *optarg ? optarg : NULL;
+			break;
+		default:
+			return usage(argv[0]);
+		}
+	}
+
+	if (argc - optind != 3)
+		return usage(argv[0]);
+
+	out.instance = argv[optind];
+	out.conf = fopen(argv[optind + 1], "a");
+	out.hosts = fopen(argv[optind + 2], "a");
+	if (!out.conf || !out.hosts) {
+		perror("fopen");
+		return 1;
+	}
+
+	ctx = uci_alloc_context();
+	if (!ctx)
+		return 1;
+
+	/*
+	 * same view of the config as config_load, which runs
+	 * "uci -P /var/state -S show": these are the steps uci's cli.c
+	 * takes for -P and -S
+	 */
+	uci_add_delta_path(ctx, ctx->savedir);
+	uci_set_savedir(ctx, "/var/state");
+	ctx->flags &= ~UCI_FLAG_STRICT;
+
+	if (uci_load(ctx, "dhcp", &p) || !p) {
+		uci_perror(ctx, "dhcp");
+		return 1;
+	}
+
+	for (i = 0; i < sizeof(handlers) / sizeof(handlers[0]); i++) {
+		uci_foreach_element(&p->sections, e) {
+			s = uci_to_section(e);
+			if (strcmp(s->type, handlers[i].type))
+				continue;
+
+			/* use entry when no instance entry set, or if it matches */
+			instance = get(s, "instance");
+			if (instance && strcmp(instance, out.instance))
+				continue;
+
+			handlers[i].add(&out, s);
+		}
+	}
+
+	uci_free_context(ctx);
+
+	if (fclose(out.conf) || fclose(out.hosts)) {
+		perror("fclose");
+		return 1;
+	}
+
+	return 0;
+}
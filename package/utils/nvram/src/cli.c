@@ -104,6 +104,42 @@ static int do_set(nvram_handle_t *nvram, const char *pair)
 	return stat;
 }
 
+/* Apply "set var=value" / "unset var" / "commit" lines read from stdin. */
+static int do_batch(nvram_handle_t *nvram, int *commit)
+{
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	int stat = 0;
+
+	while( (len = getline(&line, &size, stdin)) > -1 )
+	{
+		if( len > 0 && line[len-1] == '\n' )
+			line[--len] = '\0';
+
+		if( !strncmp(line, "set ", 4) )
+		{
+			stat |= do_set(nvram, line + 4);
+		}
+		else if( !strncmp(line, "unset ", 6) )
+		{
+			stat |= do_unset(nvram, line + 6);
+		}
+		else if( !strcmp(line, "commit") )
+		{
+			*commit = 1;
+		}
+		else if( len > 0 && line[0] != '#' )
+		{
+			fprintf(stderr, "Ignoring invalid batch line '%s' !\n", line);
+			stat = 1;
+		}
+	}
+
+	free(line);
+	return stat;
+}
+
 static int do_info(nvram_handle_t *nvram)
 {
 	nvram_header_t *hdr = nvram_header(nvram);
@@ -143,6 +179,7 @@ static void usage(void)
 		"	nvram set variable=value [set ...]\n"
 		"	nvram unset variable [unset ...]\n"
 		"	nvram commit\n"
+		"	nvram batch < commands\n"
 	);
 }
 
@@ -163,7 +200,7 @@ int main( int argc, const char *argv[] )
 	/* Ugly... iterate over arguments to see whether we can expect a write */
 	if( ( !strcmp(argv[1], "set")  && 2 < argc ) ||
 		( !strcmp(argv[1], "unset") && 2 < argc ) ||
-		!strcmp(argv[1], "commit") )
+		!strcmp(argv[1], "commit") || !strcmp(argv[1], "batch") )
 		write = 1;
 
 
@@ -215,6 +252,11 @@ int main( int argc, const char *argv[] )
 				commit = 1;
 				done++;
 			}
+			else if( !strcmp(argv[i], "batch") )
+			{
+				stat = do_batch(nvram, &commit);
+				done++;
+			}
 			else
 			{
 				fprintf(stderr, "Unknown option '%s' !\n", argv[i]);
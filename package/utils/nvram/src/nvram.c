@@ -26,34 +26,93 @@ size_t nvram_part_size = 0;
  * -- Helper functions --
  */
 
-/* String hash */
+/* String hash (FNV-1a) */
 static uint32_t hash(const char *s)
 {
-	uint32_t hash = 0;
+	uint32_t hash = 2166136261U;
 
 	while (*s)
-		hash = 31 * hash + *s++;
+		hash = (hash ^ (uint8_t)*s++) * 16777619U;
 
 	return hash;
 }
 
+/* Find the index slot holding name, or the free slot it belongs into. */
+static uint32_t _nvram_slot(nvram_handle_t *h, const char *name)
+{
+	uint32_t mask = h->index_size - 1;
+	uint32_t i = hash(name) & mask;
+	nvram_tuple_t *t;
+
+	while ((t = h->nvram_index[i]) != NULL && strcmp(t->name, name))
+		i = (i + 1) & mask;
+
+	return i;
+}
+
+/* Double the index size and reinsert all tuples. */
+static int _nvram_grow(nvram_handle_t *h)
+{
+	uint32_t size = h->index_size ? h->index_size * 2 : NVRAM_INDEX_MIN;
+	nvram_tuple_t **index, *t;
+
+	if (!(index = calloc(size, sizeof(*index))))
+		return -1;
+
+	free(h->nvram_index);
+	h->nvram_index = index;
+	h->index_size = size;
+
+	for (t = h->nvram_list; t; t = t->next)
+		h->nvram_index[_nvram_slot(h, t->name)] = t;
+
+	return 0;
+}
+
+/* Remove an index slot, moving back entries of the same probe chain. */
+static void _nvram_index_del(nvram_handle_t *h, uint32_t i)
+{
+	uint32_t mask = h->index_size - 1;
+	uint32_t j = i, k;
+
+	h->nvram_index[i] = NULL;
+	h->index_used--;
+
+	for (j = (i + 1) & mask; h->nvram_index[j]; j = (j + 1) & mask) {
+		k = hash(h->nvram_index[j]->name) & mask;
+
+		/* Home slot in (i, j] cyclically, the entry stays reachable */
+		if ((i < j) ? (k > i && k <= j) : (k > i || k <= j))
+			continue;
+
+		h->nvram_index[i] = h->nvram_index[j];
+		h->nvram_index[j] = NULL;
+		i = j;
+	}
+}
+
 /* Free all tuples. */
 static void _nvram_free(nvram_handle_t *h)
 {
-	uint32_t i;
 	nvram_tuple_t *t, *next;
 
-	/* Free hash table */
-	for (i = 0; i < NVRAM_ARRAYSIZE(h->nvram_hash); i++) {
-		for (t = h->nvram_hash[i]; t; t = next) {
-			next = t->next;
-			if (t->value)
-				free(t->value);
-			free(t);
-		}
-		h->nvram_hash[i] = NULL;
+	/* Clear index */
+	if (h->nvram_index)
+		memset(h->nvram_index, 0, h->index_size * sizeof(*h->nvram_index));
+
+	h->index_used = 0;
+
+	/* Free tuple list */
+	for (t = h->nvram_list; t; t = next) {
+		next = t->next;
+		if (t->value)
+			free(t->value);
+		free(t);
 	}
 
+	h->nvram_list = NULL;
+	h->nvram_tail = &h->nvram_list;
+
 	/* Free dead table */
 	for (t = h->nvram_dead; t; t = next) {
 		next = t->next;
@@ -153,55 +212,46 @@ nvram_header_t * nvram_header(nvram_handle_t *h)
 /* Get the value of an NVRAM variable. */
 char * nvram_get(nvram_handle_t *h, const char *name)
 {
-	uint32_t i;
 	nvram_tuple_t *t;
-	char *value;
 
-	if (!name)
+	if (!name || !h->index_size)
 		return NULL;
 
-	/* Hash the name */
-	i = hash(name) % NVRAM_ARRAYSIZE(h->nvram_hash);
-
-	/* Find the associated tuple in the hash table */
-	for (t = h->nvram_hash[i]; t && strcmp(t->name, name); t = t->next);
-
-	value = t ? t->value : NULL;
+	/* Find the associated tuple in the index */
+	t = h->nvram_index[_nvram_slot(h, name)];
 
-	return value;
+	return t ? t->value : NULL;
 }
 
 /* Set the value of an NVRAM variable. */
 int nvram_set(nvram_handle_t *h, const char *name, const char *value)
 {
 	uint32_t i;
-	nvram_tuple_t *t, *u, **prev;
+	nvram_tuple_t *t, *u;
 
-	/* Hash the name */
-	i = hash(name) % NVRAM_ARRAYSIZE(h->nvram_hash);
+	/* Keep the index at most 3/4 full */
+	if ((h->index_used + 1) * 4 > h->index_size * 3 && _nvram_grow(h))
+		return -12; /* -ENOMEM */
 
-	/* Find the associated tuple in the hash table */
-	for (prev = &h->nvram_hash[i], t = *prev;
-		 t && strcmp(t->name, name); prev = &t->next, t = *prev);
+	/* Find the associated tuple in the index */
+	i = _nvram_slot(h, name);
+	t = h->nvram_index[i];
 
 	/* (Re)allocate tuple */
 	if (!(u = _nvram_realloc(h, t, name, value)))
 		return -12; /* -ENOMEM */
 
 	/* Value reallocated */
-	if (t && t == u)
+	if (t)
 		return 0;
 
-	/* Move old tuple to the dead table */
-	if (t) {
-		*prev = t->next;
-		t->next = h->nvram_dead;
-		h->nvram_dead = t;
-	}
+	/* Append new tuple, existing ones keep their place in flash */
+	u->next = NULL;
+	*h->nvram_tail = u;
+	h->nvram_tail = &u->next;
 
-	/* Add new tuple to the hash table */
-	u->next = h->nvram_hash[i];
-	h->nvram_hash[i] = u;
+	h->nvram_index[i] = u;
+	h->index_used++;
 
 	return 0;
 }
@@ -212,22 +262,26 @@ int nvram_unset(nvram_handle_t *h, const char *name)
 	uint32_t i;
 	nvram_tuple_t *t, **prev;
 
-	if (!name)
+	if (!name || !h->index_size)
 		return 0;
 
-	/* Hash the name */
-	i = hash(name) % NVRAM_ARRAYSIZE(h->nvram_hash);
+	/* Find the associated tuple in the index */
+	i = _nvram_slot(h, name);
 
-	/* Find the associated tuple in the hash table */
-	for (prev = &h->nvram_hash[i], t = *prev;
-		 t && strcmp(t->name, name); prev = &t->next, t = *prev);
+	if (!(t = h->nvram_index[i]))
+		return 0;
+
+	_nvram_index_del(h, i);
+
+	for (prev = &h->nvram_list; *prev != t; prev = &(*prev)->next);
+
+	*prev = t->next;
+	if (h->nvram_tail == &t->next)
+		h->nvram_tail = prev;
 
 	/* Move it to the dead table */
-	if (t) {
-		*prev = t->next;
-		t->next = h->nvram_dead;
-		h->nvram_dead = t;
-	}
+	t->next = h->nvram_dead;
+	h->nvram_dead = t;
 
 	return 0;
 }
@@ -235,24 +289,23 @@ int nvram_unset(nvram_handle_t *h, const char *name)
 /* Get all NVRAM variables. */
 nvram_tuple_t * nvram_getall(nvram_handle_t *h)
 {
-	int i;
-	nvram_tuple_t *t, *l, *x;
+	nvram_tuple_t *t, *l, *x, **tail;
 
 	l = NULL;
+	tail = &l;
 
-	for (i = 0; i < NVRAM_ARRAYSIZE(h->nvram_hash); i++) {
-		for (t = h->nvram_hash[i]; t; t = t->next) {
-			if( (x = (nvram_tuple_t *) malloc(sizeof(nvram_tuple_t))) != NULL )
-			{
-				x->name  = t->name;
-				x->value = t->value;
-				x->next  = l;
-				l = x;
-			}
-			else
-			{
-				break;
-			}
+	for (t = h->nvram_list; t; t = t->next) {
+		if( (x = (nvram_tuple_t *) malloc(sizeof(nvram_tuple_t))) != NULL )
+		{
+			x->name  = t->name;
+			x->value = t->value;
+			x->next  = NULL;
+			*tail = x;
+			tail = &x->next;
+		}
+		else
+		{
+			break;
 		}
 	}
 
@@ -262,14 +315,22 @@ nvram_tuple_t * nvram_getall(nvram_handle_t *h)
 /* Regenerate NVRAM. */
 int nvram_commit(nvram_handle_t *h)
 {
-	nvram_header_t *header = nvram_header(h);
+	size_t size = nvram_part_size - h->offset;
 	char *init, *config, *refresh, *ncdl;
-	char *ptr, *end;
-	int i;
+	char *buf, *ptr, *end;
+	size_t first, last, nlen, vlen;
+	long pagesize;
 	nvram_tuple_t *t;
+	nvram_header_t *header;
 	nvram_header_t tmp;
 	uint8_t crc;
 
+	/* Build the new image aside, so it can be compared with the old one */
+	if (!(buf = malloc(size)))
+		return -12; /* -ENOMEM */
+
+	header = (nvram_header_t *) buf;
+
 	/* Regenerate header */
 	header->magic = NVRAM_MAGIC;
 	header->crc_ver_init = (NVRAM_VERSION << 8);
@@ -289,33 +350,29 @@ int nvram_commit(nvram_handle_t *h)
 	}
 
 	/* Clear data area */
-	ptr = (char *) header + sizeof(nvram_header_t);
-	memset(ptr, 0xFF, nvram_part_size - h->offset - sizeof(nvram_header_t));
+	ptr = buf + sizeof(nvram_header_t);
+	memset(ptr, 0xFF, size - sizeof(nvram_header_t));
 	memset(&tmp, 0, sizeof(nvram_header_t));
 
 	/* Leave space for a double NUL at the end */
-	end = (char *) header + nvram_part_size - h->offset - 2;
+	end = buf + size - 2;
 
 	/* Write out all tuples */
-	for (i = 0; i < NVRAM_ARRAYSIZE(h->nvram_hash); i++) {
-		for (t = h->nvram_hash[i]; t; t = t->next) {
-			if ((ptr + strlen(t->name) + 1 + strlen(t->value) + 1) > end)
-				break;
-			ptr += sprintf(ptr, "%s=%s", t->name, t->value) + 1;
-		}
+	for (t = h->nvram_list; t; t = t->next) {
+		nlen = strlen(t->name);
+		vlen = strlen(t->value);
+		if ((ptr + nlen + 1 + vlen + 1) > end)
+			break;
+		memcpy(ptr, t->name, nlen);
+		ptr += nlen;
+		*ptr++ = '=';
+		memcpy(ptr, t->value, vlen + 1);
+		ptr += vlen + 1;
 	}
 
-	/* End with a double NULL and pad to 4 bytes */
-	*ptr = '\0';
-	ptr++;
-
-	if( (int)ptr % 4 )
-		memset(ptr, 0, 4 - ((int)ptr % 4));
-
-	ptr++;
-
-	/* Set new length */
-	header->len = NVRAM_ROUNDUP(ptr - (char *) header, 4);
+	/* End with a double NUL and pad to 4 bytes */
+	header->len = NVRAM_ROUNDUP(ptr + 2 - buf, 4);
+	memset(ptr, 0, header->len - (ptr - buf));
 
 	/* Little-endian CRC8 over the last 11 bytes of the header */
 	tmp.crc_ver_init   = header->crc_ver_init;
@@ -331,12 +388,30 @@ int nvram_commit(nvram_handle_t *h)
 	/* Set new CRC8 */
 	header->crc_ver_init |= crc;
 
-	/* Write out */
-	msync(h->mmap, h->length, MS_SYNC);
+	/* Find the changed span, nothing to write if there is none */
+	ptr = (char *) nvram_header(h);
+
+	for (first = 0; first < size && buf[first] == ptr[first]; first++);
+
+	if (first == size) {
+		free(buf);
+		return 0;
+	}
+
+	for (last = size - 1; buf[last] == ptr[last]; last--);
+
+	memcpy(ptr + first, buf + first, last - first + 1);
+	free(buf);
+
+	/* Write out the touched pages only */
+	pagesize = sysconf(_SC_PAGESIZE);
+	first = (h->offset + first) & ~(pagesize - 1);
+	last += h->offset + 1;
+
+	msync(h->mmap + first, last - first, MS_SYNC);
 	fsync(h->fd);
 
-	/* Reinitialize hash table */
-	return _nvram_rehash(h);
+	return 0;
 }
 
 /* Open NVRAM and obtain a handle. */
@@ -397,6 +472,7 @@ nvram_handle_t * nvram_open(const char *file, int rdonly)
 				h->mmap   = mmap_area;
 				h->length = nvram_part_size;
 				h->offset = offset;
+				h->nvram_tail = &h->nvram_list;
 
 				header = nvram_header(h);
 
@@ -424,6 +500,7 @@ nvram_handle_t * nvram_open(const char *file, int rdonly)
 int nvram_close(nvram_handle_t *h)
 {
 	_nvram_free(h);
+	free(h->nvram_index);
 	munmap(h->mmap, h->length);
 	close(h->fd);
 	free(h);
@@ -511,12 +588,14 @@ int nvram_to_staging(void)
 	return stat;
 }
 
-/* Copy staging file to NVRAM device. */
+/* Copy staging file to NVRAM device, skip the flash write if unchanged. */
 int staging_to_nvram(void)
 {
 	int fdmtd, fdstg, stat;
 	char *mtd = nvram_find_mtd();
 	char buf[nvram_part_size];
+	char cur[nvram_part_size];
+	size_t first, last;
 
 	stat = -1;
 
@@ -526,12 +605,31 @@ int staging_to_nvram(void)
 		{
 			if( read(fdstg, buf, sizeof(buf)) == sizeof(buf) )
 			{
-				if( (fdmtd = open(mtd, O_WRONLY | O_SYNC)) > -1 )
+				if( (fdmtd = open(mtd, O_RDWR | O_SYNC)) > -1 )
 				{
-					write(fdmtd, buf, sizeof(buf));
-					fsync(fdmtd);
+					first = 0;
+					last = sizeof(buf) - 1;
+
+					/* Narrow the write down to the bytes which differ */
+					if( read(fdmtd, cur, sizeof(cur)) == sizeof(cur) )
+					{
+						for( ; first < sizeof(buf) && buf[first] == cur[first]; first++ );
+						for( ; last > first && buf[last] == cur[last]; last-- );
+					}
+
+					if( first < sizeof(buf) )
+					{
+						if( pwrite(fdmtd, buf + first, last - first + 1, first) == (ssize_t)(last - first + 1) )
+							stat = 0;
+
+						fsync(fdmtd);
+					}
+					else
+					{
+						stat = 0;
+					}
+
 					close(fdmtd);
-					stat = 0;
 				}
 			}
 
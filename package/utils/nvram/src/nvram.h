@@ -48,7 +48,11 @@ struct nvram_handle {
 	char *mmap;
 	unsigned int length;
 	unsigned int offset;
-	struct nvram_tuple *nvram_hash[257];
+	struct nvram_tuple **nvram_index;	/* open addressed, linear probing */
+	unsigned int index_size;		/* power of two */
+	unsigned int index_used;
+	struct nvram_tuple *nvram_list;		/* tuples in flash order */
+	struct nvram_tuple **nvram_tail;
 	struct nvram_tuple *nvram_dead;
 };
 
@@ -72,7 +76,7 @@ int nvram_unset(nvram_handle_t *h, const char *name);
 /* Get all NVRAM variables. */
 nvram_tuple_t * nvram_getall(nvram_handle_t *h);
 
-/* Regenerate NVRAM. */
+/* Regenerate NVRAM, only the bytes which changed are written out. */
 int nvram_commit(nvram_handle_t *h);
 
 /* Open NVRAM and obtain a handle. */
@@ -114,6 +118,7 @@ char * nvram_find_staging(void);
 
 /* NVRAM constants */
 #define NVRAM_MIN_SPACE			0x8000
+#define NVRAM_INDEX_MIN			512
 #define NVRAM_MAGIC			0x48534C46	/* 'FLSH' */
 #define NVRAM_VERSION		1
 
@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""
+# Render a boot trace as a timeline.
+#
+# Boot the device with "boottrace" on the kernel command line and copy
+# /tmp/boottrace.log from it. Each line of the trace is one JSON object
+# with the category (preinit, init or hotplug), name, start time and
+# duration in milliseconds since kernel start.
+#
+# Init script times cover the script itself; procd services keep starting
+# in the background after their init script returned.
+#
+# Copyright (C) 2018 OpenWrt.org
+"""
+
+import sys
+import json
+import argparse
+
+
+def load(path):
+	events = []
+	with open(path) as f:
+		for n, line in enumerate(f, 1):
+			line = line.strip()
+			if not line:
+				continue
+			try:
+				ev = json.loads(line)
+				ev["ts"] = int(ev["ts"])
+				ev["dur"] = int(ev["dur"])
+			except (ValueError, KeyError) as e:
+				print("%s:%d: skipping bad line (%s)" % (path, n, e),
+				      file=sys.stderr)
+				continue
+			events.append(ev)
+	events.sort(key=lambda ev: (ev["ts"], -ev["dur"]))
+	return events
+
+
+def timeline(events, width, mindur):
+	start = events[0]["ts"]
+	end = max(ev["ts"] + ev["dur"] for ev in events)
+	scale = max(end - start, 1) / float(width)
+
+	print("%9s %8s  %-8s %-40s" % ("start", "ms", "category", "name"))
+	for ev in events:
+		if ev["dur"] < mindur:
+			continue
+		col = int((ev["ts"] - start) / scale)
+		bar = max(int(ev["dur"] / scale), 1)
+		print("%9.2f %8d  %-8s %-40.40s |%s%s" % (
+			ev["ts"] / 1000.0, ev["dur"], ev["cat"], ev["name"],
+			" " * col, "#" * min(bar, width - col)))
+
+
+def summary(events, top):
+	total = {}
+	for ev in events:
+		total[ev["cat"]] = total.get(ev["cat"], 0) + ev["dur"]
+
+	print("\nTime per category:")
+	for cat, dur in sorted(total.items(), key=lambda t: -t[1]):
+		print("  %-8s %8d ms" % (cat, dur))
+
+	print("\nSlowest %d stages:" % top)
+	for ev in sorted(events, key=lambda ev: -ev["dur"])[:top]:
+		print("  %8d ms  %-8s %s" % (ev["dur"], ev["cat"], ev["name"]))
+
+	first = events[0]["ts"]
+	last = max(ev["ts"] + ev["dur"] for ev in events)
+	print("\nFirst event at %.2f s, last one finished at %.2f s" % (
+		first / 1000.0, last / 1000.0))
+
+
+def chrome(events, path):
+	# "complete" events of the Trace Event Format, in microseconds, for
+	# chrome://tracing or ui.perfetto.dev
+	out = [{
+		"name": ev["name"],
+		"cat": ev["cat"],
+		"ph": "X",
+		"ts": ev["ts"] * 1000,
+		"dur": ev["dur"] * 1000,
+		"pid": 1,
+		"tid": ev.get("pid", 0),
+	} for ev in events]
+
+	with open(path, "w") as f:
+		json.dump({"traceEvents": out, "displayTimeUnit": "ms"}, f)
+
+
+def main():
+	parser = argparse.ArgumentParser(
+		description="Render an OpenWrt boot trace as a timeline")
+	parser.add_argument("trace", help="boottrace.log copied from the device")
+	parser.add_argument("-w", "--width", type=int, default=60,
+			    help="width of the timeline bars (default: 60)")
+	parser.add_argument("-m", "--min", type=int, default=0, metavar="MS",
+			    help="hide stages shorter than MS milliseconds")
+	parser.add_argument("-t", "--top", type=int, default=10,
+			    help="number of slowest stages to list (default: 10)")
+	parser.add_argument("-c", "--chrome", metavar="FILE",
+			    help="also write the trace in Chrome Trace Event format")
+	args = parser.parse_args()
+
+	events = load(args.trace)
+	if not events:
+		print("%s: no events" % args.trace, file=sys.stderr)
+		return 1
+
+	timeline(events, args.width, args.min)
+	summary(events, args.top)
+	if args.chrome:
+		chrome(events, args.chrome)
+
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main())
@@ -0,0 +1,51 @@
+#!/usr/bin/env bash
+# Print the makefiles included by a package that are not in its own directory,
+# e.g. helpers shared by the packages of a feed. Paths are resolved the way
+# make -C <package dir> resolves them, includes that depend on variables other
+# than TOPDIR, INCLUDE_DIR and CURDIR are skipped.
+#
+# usage: scan-includes.sh <topdir> <package dir>
+export LANG=C
+export LC_ALL=C
+
+topdir="$(cd "$1" && pwd -P)" || exit 1
+pkgdir="$(cd "$2" && pwd -P)" || exit 1
+
+queue="$(find "$pkgdir" -maxdepth 3 \( -name Makefile -o -name '*.mk' \))"
+seen=" "
+
+while [ -n "$queue" ]; do
+	next=
+	for file in $queue; do
+		for word in $(sed -n \
+			-e "s#\\\$[({]TOPDIR[)}]#$topdir#g" \
+			-e "s#\\\$[({]INCLUDE_DIR[)}]#$topdir/include#g" \
+			-e "s#\\\$[({]CURDIR[)}]#$pkgdir#g" \
+			-e 's/^[[:space:]]*-\{0,1\}s\{0,1\}include[[:space:]]\{1,\}//p' "$file"); do
+			case "$word" in
+				*'$'*) continue;;
+				/*) ;;
+				*) word="$pkgdir/$word";;
+			esac
+
+			for inc in $word; do
+				[ -f "$inc" ] || continue
+				inc="$(readlink -f "$inc")"
+				# rules.mk and include/ are hashed for all packages
+				case "$inc" in
+					"$pkgdir"/*|"$topdir"/rules.mk|"$topdir"/include/*) continue;;
+				esac
+				case "$seen" in
+					*" $inc "*) continue;;
+				esac
+				seen="$seen$inc "
+				next="$next $inc"
+			done
+		done
+	done
+	queue="$next"
+done
+
+for inc in $seen; do
+	echo "$inc"
+done | sort
@@ -11,12 +11,15 @@
 #include <linux/init.h>
 #include <linux/interrupt.h>
 #include <linux/module.h>
+#include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
+#include <linux/ktime.h>
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/nand.h>
 #include <linux/mtd/partitions.h>
 #include <linux/platform_device.h>
 #include <linux/delay.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/version.h>
 
@@ -187,6 +190,34 @@ static inline void
 nfc_debug_data(const char *label, void *data, int len) {}
 #endif /* AR934X_NFC_DEBUG_DATA */
 
+enum ar934x_nfc_op {
+	AR934X_NFC_OP_READ_PAGE,
+	AR934X_NFC_OP_READ_PAGE_RAW,
+	AR934X_NFC_OP_WRITE_PAGE,
+	AR934X_NFC_OP_WRITE_PAGE_RAW,
+	AR934X_NFC_OP_READ_OOB,
+	AR934X_NFC_OP_WRITE_OOB,
+	AR934X_NFC_OP_ERASE,
+
+	AR934X_NFC_OP_NUM
+};
+
+static const char * const ar934x_nfc_op_names[AR934X_NFC_OP_NUM] = {
+	[AR934X_NFC_OP_READ_PAGE]	= "read_page",
+	[AR934X_NFC_OP_READ_PAGE_RAW]	= "read_page_raw",
+	[AR934X_NFC_OP_WRITE_PAGE]	= "write_page",
+	[AR934X_NFC_OP_WRITE_PAGE_RAW]	= "write_page_raw",
+	[AR934X_NFC_OP_READ_OOB]	= "read_oob",
+	[AR934X_NFC_OP_WRITE_OOB]	= "write_oob",
+	[AR934X_NFC_OP_ERASE]		= "erase",
+};
+
+struct ar934x_nfc_op_stat {
+	unsigned long count;
+	u64 total_ns;
+	u64 max_ns;
+};
+
 struct ar934x_nfc {
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4,6,0)
 	struct mtd_info mtd;
@@ -227,6 +258,11 @@ struct ar934x_nfc {
 	int seqin_page_addr;
 	int seqin_column;
 	int seqin_read_cmd;
+
+	struct ar934x_nfc_op_stat op_stats[AR934X_NFC_OP_NUM];
+	unsigned long dma_direct;
+	unsigned long dma_bounce;
+	struct dentry *debugfs_dir;
 };
 
 static void ar934x_nfc_restart(struct ar934x_nfc *nfc);
@@ -462,8 +498,9 @@ ar934x_nfc_send_cmd(struct ar934x_nfc *nfc, unsigned command)
 }
 
 static int
-ar934x_nfc_do_rw_command(struct ar934x_nfc *nfc, int column, int page_addr,
-			 int len, u32 cmd_reg, u32 ctrl_reg, bool write)
+__ar934x_nfc_do_rw_command(struct ar934x_nfc *nfc, int column, int page_addr,
+			   int len, u32 cmd_reg, u32 ctrl_reg, bool write,
+			   dma_addr_t dma_addr)
 {
 	u32 addr0, addr1;
 	u32 dma_ctrl;
@@ -473,9 +510,6 @@ ar934x_nfc_do_rw_command(struct ar934x_nfc *nfc, int column, int page_addr,
 
 	WARN_ON(len & 3);
 
-	if (WARN_ON(len > nfc->buf_size))
-		dev_err(nfc->parent, "len=%d > buf_size=%d", len, nfc->buf_size);
-
 	if (write) {
 		dma_ctrl = AR934X_NFC_DMA_CTRL_DMA_DIR_WRITE;
 		dir = DMA_TO_DEVICE;
@@ -501,7 +535,7 @@ retry:
 	ar934x_nfc_wr(nfc, AR934X_NFC_REG_INT_STATUS, 0);
 	ar934x_nfc_wr(nfc, AR934X_NFC_REG_ADDR0_0, addr0);
 	ar934x_nfc_wr(nfc, AR934X_NFC_REG_ADDR0_1, addr1);
-	ar934x_nfc_wr(nfc, AR934X_NFC_REG_DMA_ADDR, nfc->buf_dma);
+	ar934x_nfc_wr(nfc, AR934X_NFC_REG_DMA_ADDR, dma_addr);
 	ar934x_nfc_wr(nfc, AR934X_NFC_REG_DMA_COUNT, len);
 	ar934x_nfc_wr(nfc, AR934X_NFC_REG_DATA_SIZE, len);
 	ar934x_nfc_wr(nfc, AR934X_NFC_REG_CTRL, ctrl_reg);
@@ -532,6 +566,17 @@ retry:
 	return err;
 }
 
+static int
+ar934x_nfc_do_rw_command(struct ar934x_nfc *nfc, int column, int page_addr,
+			 int len, u32 cmd_reg, u32 ctrl_reg, bool write)
+{
+	if (WARN_ON(len > nfc->buf_size))
+		dev_err(nfc->parent, "len=%d > buf_size=%d", len, nfc->buf_size);
+
+	return __ar934x_nfc_do_rw_command(nfc, column, page_addr, len, cmd_reg,
+					  ctrl_reg, write, nfc->buf_dma);
+}
+
 static int
 ar934x_nfc_send_readid(struct ar934x_nfc *nfc, unsigned command)
 {
@@ -551,15 +596,10 @@ ar934x_nfc_send_readid(struct ar934x_nfc *nfc, unsigned command)
 	return err;
 }
 
-static int
-ar934x_nfc_send_read(struct ar934x_nfc *nfc, unsigned command, int column,
-		     int page_addr, int len)
+static u32
+ar934x_nfc_get_read_cmd(struct ar934x_nfc *nfc, unsigned command)
 {
 	u32 cmd_reg;
-	int err;
-
-	nfc_dbg(nfc, "read, column=%d page=%d len=%d\n",
-		column, page_addr, len);
 
 	cmd_reg = (command & AR934X_NFC_CMD_CMD0_M) << AR934X_NFC_CMD_CMD0_S;
 
@@ -570,8 +610,21 @@ ar934x_nfc_send_read(struct ar934x_nfc *nfc, unsigned command, int column,
 		cmd_reg |= AR934X_NFC_CMD_SEQ_1C5A1CXR;
 	}
 
+	return cmd_reg;
+}
+
+static int
+ar934x_nfc_send_read(struct ar934x_nfc *nfc, unsigned command, int column,
+		     int page_addr, int len)
+{
+	int err;
+
+	nfc_dbg(nfc, "read, column=%d page=%d len=%d\n",
+		column, page_addr, len);
+
 	err = ar934x_nfc_do_rw_command(nfc, column, page_addr, len,
-				       cmd_reg, nfc->ctrl_reg, false);
+				       ar934x_nfc_get_read_cmd(nfc, command),
+				       nfc->ctrl_reg, false);
 
 	nfc_debug_data("[data] ", nfc->buf, len);
 
@@ -616,23 +669,125 @@ ar934x_nfc_send_erase(struct ar934x_nfc *nfc, unsigned command, int column,
 	ar934x_nfc_wait_dev_ready(nfc);
 }
 
+static u32
+ar934x_nfc_get_prog_cmd(unsigned command)
+{
+	u32 cmd_reg;
+
+	cmd_reg = NAND_CMD_SEQIN << AR934X_NFC_CMD_CMD0_S;
+	cmd_reg |= command << AR934X_NFC_CMD_CMD1_S;
+	cmd_reg |= AR934X_NFC_CMD_SEQ_12;
+
+	return cmd_reg;
+}
+
 static int
 ar934x_nfc_send_write(struct ar934x_nfc *nfc, unsigned command, int column,
 		     int page_addr, int len)
 {
-	u32 cmd_reg;
-
 	nfc_dbg(nfc, "write, column=%d page=%d len=%d\n",
 		column, page_addr, len);
 
 	nfc_debug_data("[data] ", nfc->buf, len);
 
-	cmd_reg = NAND_CMD_SEQIN << AR934X_NFC_CMD_CMD0_S;
-	cmd_reg |= command << AR934X_NFC_CMD_CMD1_S;
-	cmd_reg |= AR934X_NFC_CMD_SEQ_12;
-
 	return ar934x_nfc_do_rw_command(nfc, column, page_addr, len,
-					cmd_reg, nfc->ctrl_reg, true);
+					ar934x_nfc_get_prog_cmd(command),
+					nfc->ctrl_reg, true);
+}
+
+/*
+ * The page buffers of the NAND core are usually kmalloc'ed, so the
+ * controller can DMA to and from them directly. Reads need cache line
+ * alignment because the cache gets invalidated over the whole buffer.
+ */
+static bool
+ar934x_nfc_map_buf(struct ar934x_nfc *nfc, const u8 *buf, int len,
+		   enum dma_data_direction dir, dma_addr_t *dma)
+{
+	unsigned long align;
+
+	align = (dir == DMA_FROM_DEVICE) ? dma_get_cache_alignment() : 4;
+
+	if (!IS_ALIGNED((unsigned long) buf, align) || !IS_ALIGNED(len, align) ||
+	    !virt_addr_valid(buf) || !virt_addr_valid(buf + len - 1))
+		goto bounce;
+
+	*dma = dma_map_single(nfc->parent, (void *) buf, len, dir);
+	if (dma_mapping_error(nfc->parent, *dma))
+		goto bounce;
+
+	nfc->dma_direct++;
+	return true;
+
+bounce:
+	nfc->dma_bounce++;
+	return false;
+}
+
+static int
+ar934x_nfc_read_to(struct ar934x_nfc *nfc, int column, int page_addr,
+		   u8 *buf, int len)
+{
+	dma_addr_t dma;
+	int err;
+
+	if (!ar934x_nfc_map_buf(nfc, buf, len, DMA_FROM_DEVICE, &dma)) {
+		err = ar934x_nfc_send_read(nfc, NAND_CMD_READ0, column,
+					   page_addr, len);
+		if (!err)
+			memcpy(buf, nfc->buf, len);
+
+		return err;
+	}
+
+	nfc_dbg(nfc, "read direct, column=%d page=%d len=%d\n",
+		column, page_addr, len);
+
+	err = __ar934x_nfc_do_rw_command(nfc, column, page_addr, len,
+			ar934x_nfc_get_read_cmd(nfc, NAND_CMD_READ0),
+			nfc->ctrl_reg, false, dma);
+
+	dma_unmap_single(nfc->parent, dma, len, DMA_FROM_DEVICE);
+
+	return err;
+}
+
+static int
+ar934x_nfc_write_from(struct ar934x_nfc *nfc, int column, int page_addr,
+		      const u8 *buf, int len)
+{
+	dma_addr_t dma;
+	int err;
+
+	if (!ar934x_nfc_map_buf(nfc, buf, len, DMA_TO_DEVICE, &dma)) {
+		memcpy(nfc->buf, buf, len);
+		return ar934x_nfc_send_write(nfc, NAND_CMD_PAGEPROG, column,
+					     page_addr, len);
+	}
+
+	nfc_dbg(nfc, "write direct, column=%d page=%d len=%d\n",
+		column, page_addr, len);
+
+	err = __ar934x_nfc_do_rw_command(nfc, column, page_addr, len,
+			ar934x_nfc_get_prog_cmd(NAND_CMD_PAGEPROG),
+			nfc->ctrl_reg, true, dma);
+
+	dma_unmap_single(nfc->parent, dma, len, DMA_TO_DEVICE);
+
+	return err;
+}
+
+static inline void
+ar934x_nfc_op_done(struct ar934x_nfc *nfc, enum ar934x_nfc_op op,
+		   ktime_t start)
+{
+	struct ar934x_nfc_op_stat *stat = &nfc->op_stats[op];
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	stat->count++;
+	stat->total_ns += ns;
+	if (ns > stat->max_ns)
+		stat->max_ns = ns;
 }
 
 static void
@@ -722,9 +877,13 @@ ar934x_nfc_cmdfunc(struct mtd_info *mtd, unsigned int command, int column,
 		nfc->erase1_page_addr = page_addr;
 		break;
 
-	case NAND_CMD_ERASE2:
+	case NAND_CMD_ERASE2: {
+		ktime_t start = ktime_get();
+
 		ar934x_nfc_send_erase(nfc, command, -1, nfc->erase1_page_addr);
+		ar934x_nfc_op_done(nfc, AR934X_NFC_OP_ERASE, start);
 		break;
+	}
 
 	case NAND_CMD_STATUS:
 		ar934x_nfc_read_status(nfc);
@@ -872,6 +1031,7 @@ ar934x_nfc_read_oob(struct mtd_info *mtd, struct nand_chip *chip,
 		    int page)
 {
 	struct ar934x_nfc *nfc = mtd_to_ar934x_nfc(mtd);
+	ktime_t start = ktime_get();
 	int err;
 
 	nfc_dbg(nfc, "read_oob: page:%d\n", page);
@@ -883,6 +1043,8 @@ ar934x_nfc_read_oob(struct mtd_info *mtd, struct nand_chip *chip,
 
 	memcpy(chip->oob_poi, nfc->buf, mtd->oobsize);
 
+	ar934x_nfc_op_done(nfc, AR934X_NFC_OP_READ_OOB, start);
+
 	return 0;
 }
 
@@ -891,13 +1053,19 @@ ar934x_nfc_write_oob(struct mtd_info *mtd, struct nand_chip *chip,
 		     int page)
 {
 	struct ar934x_nfc *nfc = mtd_to_ar934x_nfc(mtd);
+	ktime_t start = ktime_get();
+	int err;
 
 	nfc_dbg(nfc, "write_oob: page:%d\n", page);
 
 	memcpy(nfc->buf, chip->oob_poi, mtd->oobsize);
 
-	return ar934x_nfc_send_write(nfc, NAND_CMD_PAGEPROG, mtd->writesize,
-				     page, mtd->oobsize);
+	err = ar934x_nfc_send_write(nfc, NAND_CMD_PAGEPROG, mtd->writesize,
+				    page, mtd->oobsize);
+	if (!err)
+		ar934x_nfc_op_done(nfc, AR934X_NFC_OP_WRITE_OOB, start);
+
+	return err;
 }
 
 static int
@@ -905,23 +1073,31 @@ ar934x_nfc_read_page_raw(struct mtd_info *mtd, struct nand_chip *chip,
 			 u8 *buf, int oob_required, int page)
 {
 	struct ar934x_nfc *nfc = mtd_to_ar934x_nfc(mtd);
+	ktime_t start = ktime_get();
 	int len;
 	int err;
 
 	nfc_dbg(nfc, "read_page_raw: page:%d oob:%d\n", page, oob_required);
 
-	len = mtd->writesize;
-	if (oob_required)
-		len += mtd->oobsize;
+	if (!oob_required) {
+		err = ar934x_nfc_read_to(nfc, 0, page, buf, mtd->writesize);
+		if (err)
+			return err;
+
+		goto out;
+	}
+
+	len = mtd->writesize + mtd->oobsize;
 
 	err = ar934x_nfc_send_read(nfc, NAND_CMD_READ0, 0, page, len);
 	if (err)
 		return err;
 
 	memcpy(buf, nfc->buf, mtd->writesize);
+	memcpy(chip->oob_poi, &nfc->buf[mtd->writesize], mtd->oobsize);
 
-	if (oob_required)
-		memcpy(chip->oob_poi, &nfc->buf[mtd->writesize], mtd->oobsize);
+out:
+	ar934x_nfc_op_done(nfc, AR934X_NFC_OP_READ_PAGE_RAW, start);
 
 	return 0;
 }
@@ -931,6 +1107,7 @@ ar934x_nfc_read_page(struct mtd_info *mtd, struct nand_chip *chip,
 		     u8 *buf, int oob_required, int page)
 {
 	struct ar934x_nfc *nfc = mtd_to_ar934x_nfc(mtd);
+	ktime_t start = ktime_get();
 	u32 ecc_ctrl;
 	int max_bitflips = 0;
 	bool ecc_failed;
@@ -940,16 +1117,12 @@ ar934x_nfc_read_page(struct mtd_info *mtd, struct nand_chip *chip,
 	nfc_dbg(nfc, "read_page: page:%d oob:%d\n", page, oob_required);
 
 	ar934x_nfc_enable_hwecc(nfc);
-	err = ar934x_nfc_send_read(nfc, NAND_CMD_READ0, 0, page,
-				   mtd->writesize);
+	err = ar934x_nfc_read_to(nfc, 0, page, buf, mtd->writesize);
 	ar934x_nfc_disable_hwecc(nfc);
 
 	if (err)
 		return err;
 
-	/* TODO: optimize to avoid memcpy */
-	memcpy(buf, nfc->buf, mtd->writesize);
-
 	/* read the ECC status */
 	ecc_ctrl = ar934x_nfc_rr(nfc, AR934X_NFC_REG_ECC_CTRL);
 	ecc_failed = ecc_ctrl & AR934X_NFC_ECC_CTRL_ERR_UNCORRECT;
@@ -996,6 +1169,8 @@ ar934x_nfc_read_page(struct mtd_info *mtd, struct nand_chip *chip,
 		mtd->ecc_stats.corrected += max_bitflips;
 	}
 
+	ar934x_nfc_op_done(nfc, AR934X_NFC_OP_READ_PAGE, start);
+
 	return max_bitflips;
 }
 
@@ -1004,19 +1179,27 @@ ar934x_nfc_write_page_raw(struct mtd_info *mtd, struct nand_chip *chip,
 			  const u8 *buf, int oob_required, int page)
 {
 	struct ar934x_nfc *nfc = mtd_to_ar934x_nfc(mtd);
+	ktime_t start = ktime_get();
 	int len;
+	int err;
 
 	nfc_dbg(nfc, "write_page_raw: page:%d oob:%d\n", page, oob_required);
 
-	memcpy(nfc->buf, buf, mtd->writesize);
-	len = mtd->writesize;
-
 	if (oob_required) {
+		memcpy(nfc->buf, buf, mtd->writesize);
 		memcpy(&nfc->buf[mtd->writesize], chip->oob_poi, mtd->oobsize);
-		len += mtd->oobsize;
+		len = mtd->writesize + mtd->oobsize;
+
+		err = ar934x_nfc_send_write(nfc, NAND_CMD_PAGEPROG, 0, page,
+					    len);
+	} else {
+		err = ar934x_nfc_write_from(nfc, 0, page, buf, mtd->writesize);
 	}
 
-	return ar934x_nfc_send_write(nfc, NAND_CMD_PAGEPROG, 0, page, len);
+	if (!err)
+		ar934x_nfc_op_done(nfc, AR934X_NFC_OP_WRITE_PAGE_RAW, start);
+
+	return err;
 }
 
 static int
@@ -1024,6 +1207,7 @@ ar934x_nfc_write_page(struct mtd_info *mtd, struct nand_chip *chip,
 		      const u8 *buf, int oob_required, int page)
 {
 	struct ar934x_nfc *nfc = mtd_to_ar934x_nfc(mtd);
+	ktime_t start = ktime_get();
 	int err;
 
 	nfc_dbg(nfc, "write_page: page:%d oob:%d\n", page, oob_required);
@@ -1036,14 +1220,13 @@ ar934x_nfc_write_page(struct mtd_info *mtd, struct nand_chip *chip,
 			return err;
 	}
 
-	/* TODO: optimize to avoid memcopy */
-	memcpy(nfc->buf, buf, mtd->writesize);
-
 	ar934x_nfc_enable_hwecc(nfc);
-	err = ar934x_nfc_send_write(nfc, NAND_CMD_PAGEPROG, 0, page,
-				    mtd->writesize);
+	err = ar934x_nfc_write_from(nfc, 0, page, buf, mtd->writesize);
 	ar934x_nfc_disable_hwecc(nfc);
 
+	if (!err)
+		ar934x_nfc_op_done(nfc, AR934X_NFC_OP_WRITE_PAGE, start);
+
 	return err;
 }
 
@@ -1400,6 +1583,76 @@ ar934x_nfc_setup_hwecc(struct ar934x_nfc *nfc)
 	return 0;
 }
 
+static int ar934x_nfc_stats_show(struct seq_file *m, void *v)
+{
+	struct ar934x_nfc *nfc = m->private;
+	int i;
+
+	seq_printf(m, "%-16s %10s %12s %12s\n", "op", "count", "avg_us",
+		   "max_us");
+
+	for (i = 0; i < AR934X_NFC_OP_NUM; i++) {
+		struct ar934x_nfc_op_stat *stat = &nfc->op_stats[i];
+		u64 avg = 0;
+
+		if (stat->count)
+			avg = div_u64(stat->total_ns, stat->count);
+
+		seq_printf(m, "%-16s %10lu %12llu %12llu\n",
+			   ar934x_nfc_op_names[i], stat->count,
+			   div_u64(avg, NSEC_PER_USEC),
+			   div_u64(stat->max_ns, NSEC_PER_USEC));
+	}
+
+	seq_printf(m, "dma direct: %lu bounce: %lu\n",
+		   nfc->dma_direct, nfc->dma_bounce);
+
+	return 0;
+}
+
+static int ar934x_nfc_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ar934x_nfc_stats_show, inode->i_private);
+}
+
+static ssize_t ar934x_nfc_stats_write(struct file *file,
+				      const char __user *buf,
+				      size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	struct ar934x_nfc *nfc = m->private;
+
+	/* any write resets the counters */
+	memset(nfc->op_stats, 0, sizeof(nfc->op_stats));
+	nfc->dma_direct = 0;
+	nfc->dma_bounce = 0;
+
+	return count;
+}
+
+static const struct file_operations ar934x_nfc_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ar934x_nfc_stats_open,
+	.read		= seq_read,
+	.write		= ar934x_nfc_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void
+ar934x_nfc_debugfs_init(struct ar934x_nfc *nfc)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir(dev_name(nfc->parent), NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return;
+
+	debugfs_create_file("stats", S_IRUGO | S_IWUSR, dir, nfc,
+			    &ar934x_nfc_stats_fops);
+	nfc->debugfs_dir = dir;
+}
+
 static int
 ar934x_nfc_probe(struct platform_device *pdev)
 {
@@ -1544,6 +1797,8 @@ ar934x_nfc_probe(struct platform_device *pdev)
 		goto err_free_buf;
 	}
 
+	ar934x_nfc_debugfs_init(nfc);
+
 	return 0;
 
 err_free_buf:
@@ -1562,6 +1817,7 @@ ar934x_nfc_remove(struct platform_device *pdev)
 	nfc = platform_get_drvdata(pdev);
 	if (nfc) {
 		mtd = ar934x_nfc_to_mtd(nfc);
+		debugfs_remove_recursive(nfc->debugfs_dir);
 		nand_release(mtd);
 		ar934x_nfc_free_buf(nfc);
 		free_irq(nfc->irq, nfc);
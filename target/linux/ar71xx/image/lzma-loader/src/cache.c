@@ -41,3 +41,13 @@ void flush_cache(unsigned long start_addr, unsigned long size)
 		addr += lsize;
 	}
 }
+
+void invalidate_dcache(void)
+{
+	unsigned long lsize = CONFIG_CACHELINE_SIZE;
+	unsigned long addr = 0x80000000;
+	unsigned long aend = addr + CONFIG_DCACHE_SIZE;
+
+	for (; addr < aend; addr += lsize)
+		cache_op(Index_Writeback_Inv_D, addr);
+}
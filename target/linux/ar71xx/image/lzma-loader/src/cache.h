@@ -13,5 +13,6 @@
 #define __CACHE_H
 
 void flush_cache(unsigned long start_addr, unsigned long size);
+void invalidate_dcache(void);
 
 #endif /* __CACHE_H */
@@ -33,6 +33,7 @@
 #define KSEG0			0x80000000
 #define KSEG1			0xa0000000
 
+#define KSEG0ADDR(a)		((((unsigned)(a)) & 0x1fffffffU) | KSEG0)
 #define KSEG1ADDR(a)		((((unsigned)(a)) & 0x1fffffffU) | KSEG1)
 
 #undef LZMA_DEBUG
@@ -88,6 +89,16 @@ static void halt(void)
 	for(;;);
 }
 
+/* the CP0 counter runs at half of the CPU clock */
+static __inline__ unsigned long read_c0_count(void)
+{
+	unsigned long count;
+
+	__asm__ __volatile__("mfc0	%0, $9" : "=r" (count));
+
+	return count;
+}
+
 static __inline__ unsigned long get_be32(void *buf)
 {
 	unsigned char *p = buf;
@@ -177,7 +188,14 @@ static void lzma_init_data(void)
 	unsigned long kernel_ofs;
 	unsigned long kernel_size;
 
-	flash_base = (unsigned char *) KSEG1ADDR(AR71XX_FLASH_START);
+	/*
+	 * Read the flash through the cached segment, the uncached one
+	 * makes every byte fed to the decoder a separate flash access.
+	 * Drop whatever the boot loader may have left in the D-cache for
+	 * the flash range first.
+	 */
+	invalidate_dcache();
+	flash_base = (unsigned char *) KSEG0ADDR(AR71XX_FLASH_START);
 
 	printf("Looking for OpenWrt image... ");
 
@@ -216,14 +234,18 @@ void loader_main(unsigned long reg_a0, unsigned long reg_a1,
 {
 	void (*kernel_entry) (unsigned long, unsigned long, unsigned long,
 			      unsigned long);
+	unsigned long t_start, t_found, t_decomp, t_flush;
 	int res;
 
+	t_start = read_c0_count();
+
 	board_init();
 
 	printf("\n\nOpenWrt kernel loader for AR7XXX/AR9XXX\n");
 	printf("Copyright (C) 2011 Gabor Juhos <juhosg@openwrt.org>\n");
 
 	lzma_init_data();
+	t_found = read_c0_count();
 
 	res = lzma_init_props();
 	if (res != LZMA_RESULT_OK) {
@@ -247,8 +269,14 @@ void loader_main(unsigned long reg_a0, unsigned long reg_a1,
 	} else {
 		printf("done!\n");
 	}
+	t_decomp = read_c0_count();
 
 	flush_cache(kernel_la, lzma_outsize);
+	t_flush = read_c0_count();
+
+	printf("Loader timing (CP0 count ticks): locate %lu, decompress %lu, "
+	       "flush %lu\n", t_found - t_start, t_decomp - t_found,
+	       t_flush - t_decomp);
 
 	printf("Starting kernel at %08x...\n\n", kernel_la);
 
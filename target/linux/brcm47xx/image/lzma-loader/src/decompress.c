@@ -95,13 +95,19 @@ extern unsigned char workspace[];
 
 unsigned int offset;
 unsigned char *data;
+/* end of the compressed kernel partition */
+static unsigned char *data_end;
+
+/* the decoder is fed from a RAM copy of the flash, one chunk per callback */
+#define INPUT_CHUNK_SIZE	4096
+
+static unsigned int input_chunk[INPUT_CHUNK_SIZE / 4];
+static unsigned int val;
 
 /* flash access should be aligned, so wrapper is used */
 /* read byte from the flash, all accesses are 32-bit aligned */
 static int read_byte(void *object, unsigned char **buffer, UInt32 *bufferSize)
 {
-	static unsigned int val;
-
 	if (((unsigned int)offset % 4) == 0) {
 		val = *(unsigned int *)data;
 		data += 4;
@@ -121,6 +127,40 @@ static __inline__ unsigned char get_byte(void)
 	return read_byte(0, &buffer, &fake), *buffer;
 }
 
+/* copy the next chunk from the flash with 32-bit accesses */
+static int read_chunk(void *object, unsigned char **buffer, UInt32 *bufferSize)
+{
+	unsigned int *src = (unsigned int *)data;
+	unsigned int len = INPUT_CHUNK_SIZE;
+	int i;
+
+	/* return what is left from the word read by read_byte() first */
+	if (offset & 3) {
+		*bufferSize = 4 - (offset & 3);
+		*buffer = ((unsigned char *)&val) + (offset & 3);
+		offset += *bufferSize;
+
+		return LZMA_RESULT_OK;
+	}
+
+	/* do not read past the partition, the last word may be partial */
+	if (data >= data_end)
+		len = 0;
+	else if (data_end - data < len)
+		len = data_end - data;
+
+	for (i = 0; i < (len + 3) / 4; i++)
+		input_chunk[i] = src[i];
+
+	data += len;
+	offset += len;
+
+	*bufferSize = len;
+	*buffer = (unsigned char *)input_chunk;
+
+	return LZMA_RESULT_OK;
+}
+
 /* should be the first function */
 void entry(unsigned long icache_size, unsigned long icache_lsize, 
 	unsigned long dcache_size, unsigned long dcache_lsize,
@@ -132,9 +172,10 @@ void entry(unsigned long icache_size, unsigned long icache_lsize,
 	unsigned int lp; /* literal pos state bits */
 	unsigned int pb; /* pos state bits */
 	unsigned int osize; /* uncompressed size */
+	struct trx_header *trx;
 
 	ILzmaInCallback callback;
-	callback.Read = read_byte;
+	callback.Read = read_chunk;
 
 	/* look for trx header, 32-bit data access */
 	for (data = ((unsigned char *) KSEG1ADDR(BCM4710_FLASH));
@@ -144,11 +185,17 @@ void entry(unsigned long icache_size, unsigned long icache_lsize,
 
 	if (((struct trx_header *)data)->magic == EDIMAX_PS_HEADER_MAGIC)
 		data += EDIMAX_PS_HEADER_LEN;
-	/* compressed kernel is in the partition 0 or 1 */
-	if (((struct trx_header *)data)->offsets[1] > 65536) 
-		data += ((struct trx_header *)data)->offsets[0];
-	else
-		data += ((struct trx_header *)data)->offsets[1];
+	trx = (struct trx_header *)data;
+	/* compressed kernel is in the partition 0 or 1, it ends where the
+	 * next partition starts or at the end of the image */
+	if (trx->offsets[1] > 65536) {
+		data += trx->offsets[0];
+		data_end = (unsigned char *)trx + trx->offsets[1];
+	} else {
+		data += trx->offsets[1];
+		data_end = (unsigned char *)trx +
+			(trx->offsets[2] ? trx->offsets[2] : trx->len);
+	}
 
 	offset = 0;
 
@@ -554,7 +554,7 @@ static void cns3xxx_alloc_rx_buf(struct sw *sw, int received)
 	rx_ring->alloc_index = i;
 }
 
-static void eth_check_num_used(struct _tx_ring *tx_ring)
+static void eth_check_num_used(struct sw *sw, struct _tx_ring *tx_ring)
 {
 	bool stop = false;
 	int i;
@@ -565,6 +565,10 @@ static void eth_check_num_used(struct _tx_ring *tx_ring)
 	if (tx_ring->stopped == stop)
 		return;
 
+	/* no more xmit to flush a pending batch, kick the DMA now */
+	if (stop)
+		enable_tx_dma(sw);
+
 	tx_ring->stopped = stop;
 	for (i = 0; i < 4; i++) {
 		struct port *port = switch_port_tab[i];
@@ -612,7 +616,7 @@ static void eth_complete_tx(struct sw *sw)
 	}
 	tx_ring->free_index = index;
 	tx_ring->num_used -= i;
-	eth_check_num_used(tx_ring);
+	eth_check_num_used(sw, tx_ring);
 }
 
 static int eth_poll(struct napi_struct *napi, int budget)
@@ -680,24 +684,22 @@ static int eth_poll(struct napi_struct *napi, int budget)
 
 			/* RX Hardware checksum offload */
 			skb->ip_summed = CHECKSUM_NONE;
-			switch (desc->prot) {
-				case 1:
-				case 2:
-				case 5:
-				case 6:
-				case 13:
-				case 14:
-					if (!desc->l4f) {
-						skb->ip_summed = CHECKSUM_UNNECESSARY;
-						napi_gro_receive(napi, skb);
+			if (dev->features & NETIF_F_RXCSUM) {
+				switch (desc->prot) {
+					case 1:
+					case 2:
+					case 5:
+					case 6:
+					case 13:
+					case 14:
+						if (!desc->l4f && !desc->ipf)
+							skb->ip_summed = CHECKSUM_UNNECESSARY;
 						break;
-					}
-					/* fall through */
-				default:
-					netif_receive_skb(skb);
-					break;
+				}
 			}
 
+			napi_gro_receive(napi, skb);
+
 			sw->frag_first = NULL;
 			sw->frag_last = NULL;
 		}
@@ -774,6 +776,7 @@ static int eth_xmit(struct sk_buff *skb, struct net_device *dev)
 	spin_lock_bh(&tx_lock);
 	if ((tx_ring->num_used + nr_desc + 1) >= TX_DESCS) {
 		spin_unlock_bh(&tx_lock);
+		enable_tx_dma(sw);
 		return NETDEV_TX_BUSY;
 	}
 
@@ -827,7 +830,9 @@ static int eth_xmit(struct sk_buff *skb, struct net_device *dev)
 	dev->stats.tx_packets++;
 	dev->stats.tx_bytes += skb->len;
 
-	enable_tx_dma(sw);
+	/* kick the DMA once per batch, e.g. for all GSO segments of a skb */
+	if (!skb->xmit_more || netif_queue_stopped(dev))
+		enable_tx_dma(sw);
 
 	return NETDEV_TX_OK;
 }
@@ -1224,7 +1229,9 @@ static int eth_init_one(struct platform_device *pdev)
 		dev->netdev_ops = &cns3xxx_netdev_ops;
 		dev->ethtool_ops = &cns3xxx_ethtool_ops;
 		dev->tx_queue_len = 1000;
-		dev->features = NETIF_F_IP_CSUM | NETIF_F_SG | NETIF_F_FRAGLIST;
+		dev->features = NETIF_F_IP_CSUM | NETIF_F_SG | NETIF_F_FRAGLIST |
+				NETIF_F_RXCSUM;
+		dev->hw_features = NETIF_F_RXCSUM;
 
 		switch_port_tab[port->id] = port;
 		memcpy(dev->dev_addr, &plat->hwaddr[i], ETH_ALEN);
@@ -24,6 +24,7 @@
 #include <linux/device.h>
 #include <linux/netdevice.h>
 #include <linux/timer.h>
+#include <linux/workqueue.h>
 #include <linux/ctype.h>
 #include <linux/leds.h>
 
@@ -61,6 +62,9 @@
  *  $ echo ppp0 >led2/device_name
  *  $ echo rx >led2/mode
  *
+ * The traffic statistics of all triggers are sampled by a single deferrable
+ * work, which reads the counters of each net device only once per run even
+ * if several LEDs watch it, and which stops when no trigger needs sampling.
  */
 
 #define MODE_LINK 1
@@ -70,7 +74,7 @@
 struct led_netdev_data {
 	spinlock_t lock;
 
-	struct delayed_work work;
+	struct list_head sampler_list;
 	struct notifier_block notifier;
 
 	struct led_classdev *led_cdev;
@@ -81,8 +85,60 @@ struct led_netdev_data {
 	unsigned mode;
 	unsigned link_up;
 	unsigned last_activity;
+
+	/* protected by netdev_trig_lock */
+	unsigned long next_sample;
+	u64 tx_packets;
+	u64 rx_packets;
+};
+
+/* counters of one net device, read by the sampler without any lock held */
+struct netdev_trig_stats {
+	struct list_head list;
+	struct net_device *net_dev;
+	u64 tx_packets;
+	u64 rx_packets;
 };
 
+static void netdev_trig_sample(struct work_struct *work);
+
+/* triggers waiting for traffic statistics */
+static LIST_HEAD(netdev_trig_list);
+static DEFINE_SPINLOCK(netdev_trig_lock);
+static DECLARE_DEFERRABLE_WORK(netdev_trig_sampler, netdev_trig_sample);
+static unsigned long netdev_trig_next;
+static bool netdev_trig_queued;
+
+static void netdev_trig_subscribe(struct led_netdev_data *trigger_data)
+{
+	spin_lock_bh(&netdev_trig_lock);
+
+	trigger_data->next_sample = jiffies + trigger_data->interval;
+	list_move_tail(&trigger_data->sampler_list, &netdev_trig_list);
+
+	/* pull the sampler in if it would run later than we need it */
+	if (!netdev_trig_queued ||
+	    time_after(netdev_trig_next, trigger_data->next_sample)) {
+		mod_delayed_work(system_power_efficient_wq, &netdev_trig_sampler,
+				 trigger_data->interval);
+		netdev_trig_next = trigger_data->next_sample;
+		netdev_trig_queued = true;
+	}
+
+	spin_unlock_bh(&netdev_trig_lock);
+}
+
+/*
+ * Once this returns the sampler does not touch the trigger anymore, until it
+ * is subscribed again.
+ */
+static void netdev_trig_unsubscribe(struct led_netdev_data *trigger_data)
+{
+	spin_lock_bh(&netdev_trig_lock);
+	list_del_init(&trigger_data->sampler_list);
+	spin_unlock_bh(&netdev_trig_lock);
+}
+
 static void set_baseline_state(struct led_netdev_data *trigger_data)
 {
 	if ((trigger_data->mode & MODE_LINK) != 0 && trigger_data->link_up)
@@ -90,8 +146,9 @@ static void set_baseline_state(struct led_netdev_data *trigger_data)
 	else
 		led_set_brightness(trigger_data->led_cdev, LED_OFF);
 
-	if ((trigger_data->mode & (MODE_TX | MODE_RX)) != 0 && trigger_data->link_up)
-		schedule_delayed_work(&trigger_data->work, trigger_data->interval);
+	if ((trigger_data->mode & (MODE_TX | MODE_RX)) != 0 &&
+	    trigger_data->link_up && trigger_data->net_dev)
+		netdev_trig_subscribe(trigger_data);
 }
 
 static ssize_t led_device_name_show(struct device *dev,
@@ -116,7 +173,7 @@ static ssize_t led_device_name_store(struct device *dev,
 	if (size >= IFNAMSIZ)
 		return -EINVAL;
 
-	cancel_delayed_work_sync(&trigger_data->work);
+	netdev_trig_unsubscribe(trigger_data);
 
 	spin_lock_bh(&trigger_data->lock);
 
@@ -202,7 +259,7 @@ static ssize_t led_mode_store(struct device *dev,
 	if (new_mode == -1)
 		return -EINVAL;
 
-	cancel_delayed_work_sync(&trigger_data->work);
+	netdev_trig_unsubscribe(trigger_data);
 
 	spin_lock_bh(&trigger_data->lock);
 	trigger_data->mode = new_mode;
@@ -242,7 +299,7 @@ static ssize_t led_interval_store(struct device *dev,
 
 	/* impose some basic bounds on the timer interval */
 	if (count == size && value >= 5 && value <= 10000) {
-		cancel_delayed_work_sync(&trigger_data->work);
+		netdev_trig_unsubscribe(trigger_data);
 
 		spin_lock_bh(&trigger_data->lock);
 		trigger_data->interval = msecs_to_jiffies(value);
@@ -270,7 +327,7 @@ static int netdev_trig_notify(struct notifier_block *nb,
 	if (strcmp(dev->name, trigger_data->device_name))
 		return NOTIFY_DONE;
 
-	cancel_delayed_work_sync(&trigger_data->work);
+	netdev_trig_unsubscribe(trigger_data);
 
 	spin_lock_bh(&trigger_data->lock);
 
@@ -301,23 +358,13 @@ done:
 }
 
 /* here's the real work! */
-static void netdev_trig_work(struct work_struct *work)
+static void netdev_trig_update(struct led_netdev_data *trigger_data)
 {
-	struct led_netdev_data *trigger_data = container_of(work, struct led_netdev_data, work.work);
-	struct rtnl_link_stats64 *dev_stats;
 	unsigned new_activity;
-	struct rtnl_link_stats64 temp;
 
-	if (!trigger_data->link_up || !trigger_data->net_dev || (trigger_data->mode & (MODE_TX | MODE_RX)) == 0) {
-		/* we don't need to do timer work, just reflect link state. */
-		led_set_brightness(trigger_data->led_cdev, ((trigger_data->mode & MODE_LINK) != 0 && trigger_data->link_up) ? LED_FULL : LED_OFF);
-		return;
-	}
-
-	dev_stats = dev_get_stats(trigger_data->net_dev, &temp);
 	new_activity =
-		((trigger_data->mode & MODE_TX) ? dev_stats->tx_packets : 0) +
-		((trigger_data->mode & MODE_RX) ? dev_stats->rx_packets : 0);
+		((trigger_data->mode & MODE_TX) ? trigger_data->tx_packets : 0) +
+		((trigger_data->mode & MODE_RX) ? trigger_data->rx_packets : 0);
 
 	if (trigger_data->mode & MODE_LINK) {
 		/* base state is ON (link present) */
@@ -342,7 +389,105 @@ static void netdev_trig_work(struct work_struct *work)
 	}
 
 	trigger_data->last_activity = new_activity;
-	schedule_delayed_work(&trigger_data->work, trigger_data->interval);
+}
+
+static struct netdev_trig_stats *
+netdev_trig_find_stats(struct list_head *stats, struct net_device *net_dev)
+{
+	struct netdev_trig_stats *st;
+
+	list_for_each_entry(st, stats, list)
+		if (st->net_dev == net_dev)
+			return st;
+
+	return NULL;
+}
+
+/*
+ * dev_get_stats() may sleep or take driver locks, so the devices due for
+ * sampling are collected under netdev_trig_lock, each with a reference held,
+ * and their counters are read after dropping it. Every device is read only
+ * once per run, no matter how many LEDs watch it.
+ */
+static void netdev_trig_collect(struct list_head *stats, unsigned long now)
+{
+	struct led_netdev_data *trigger_data;
+	struct netdev_trig_stats *st;
+
+	spin_lock_bh(&netdev_trig_lock);
+
+	list_for_each_entry(trigger_data, &netdev_trig_list, sampler_list) {
+		if (time_before(now, trigger_data->next_sample) ||
+		    netdev_trig_find_stats(stats, trigger_data->net_dev))
+			continue;
+
+		/* on failure the trigger stays due and is retried next run */
+		st = kmalloc(sizeof(*st), GFP_ATOMIC);
+		if (!st)
+			continue;
+
+		dev_hold(trigger_data->net_dev);
+		st->net_dev = trigger_data->net_dev;
+		list_add_tail(&st->list, stats);
+	}
+
+	spin_unlock_bh(&netdev_trig_lock);
+}
+
+static void netdev_trig_sample(struct work_struct *work)
+{
+	struct led_netdev_data *trigger_data;
+	struct netdev_trig_stats *st, *tmp;
+	struct rtnl_link_stats64 *dev_stats;
+	struct rtnl_link_stats64 temp;
+	unsigned long now = jiffies;
+	unsigned long next = now + MAX_JIFFY_OFFSET;
+	LIST_HEAD(stats);
+
+	netdev_trig_collect(&stats, now);
+
+	list_for_each_entry(st, &stats, list) {
+		dev_stats = dev_get_stats(st->net_dev, &temp);
+		st->tx_packets = dev_stats->tx_packets;
+		st->rx_packets = dev_stats->rx_packets;
+	}
+
+	spin_lock_bh(&netdev_trig_lock);
+
+	list_for_each_entry(trigger_data, &netdev_trig_list, sampler_list) {
+		/*
+		 * Triggers that subscribed or switched devices while the
+		 * counters were read have no entry, they are sampled next run.
+		 */
+		if (!time_before(now, trigger_data->next_sample)) {
+			st = netdev_trig_find_stats(&stats, trigger_data->net_dev);
+			if (st) {
+				trigger_data->tx_packets = st->tx_packets;
+				trigger_data->rx_packets = st->rx_packets;
+				netdev_trig_update(trigger_data);
+				trigger_data->next_sample = now + trigger_data->interval;
+			}
+		}
+
+		if (time_before(trigger_data->next_sample, next))
+			next = trigger_data->next_sample;
+	}
+
+	/* nothing to watch, stay idle until a trigger subscribes again */
+	netdev_trig_queued = !list_empty(&netdev_trig_list);
+	if (netdev_trig_queued) {
+		netdev_trig_next = next;
+		queue_delayed_work(system_power_efficient_wq,
+				   &netdev_trig_sampler,
+				   time_after(next, now) ? next - now : 1);
+	}
+
+	spin_unlock_bh(&netdev_trig_lock);
+
+	list_for_each_entry_safe(st, tmp, &stats, list) {
+		dev_put(st->net_dev);
+		kfree(st);
+	}
 }
 
 static void netdev_trig_activate(struct led_classdev *led_cdev)
@@ -359,7 +504,7 @@ static void netdev_trig_activate(struct led_classdev *led_cdev)
 	trigger_data->notifier.notifier_call = netdev_trig_notify;
 	trigger_data->notifier.priority = 10;
 
-	INIT_DELAYED_WORK(&trigger_data->work, netdev_trig_work);
+	INIT_LIST_HEAD(&trigger_data->sampler_list);
 
 	trigger_data->led_cdev = led_cdev;
 	trigger_data->net_dev = NULL;
@@ -405,7 +550,7 @@ static void netdev_trig_deactivate(struct led_classdev *led_cdev)
 		device_remove_file(led_cdev->dev, &dev_attr_mode);
 		device_remove_file(led_cdev->dev, &dev_attr_interval);
 
-		cancel_delayed_work_sync(&trigger_data->work);
+		netdev_trig_unsubscribe(trigger_data);
 
 		spin_lock_bh(&trigger_data->lock);
 
@@ -434,6 +579,7 @@ static int __init netdev_trig_init(void)
 static void __exit netdev_trig_exit(void)
 {
 	led_trigger_unregister(&netdev_led_trigger);
+	cancel_delayed_work_sync(&netdev_trig_sampler);
 }
 
 module_init(netdev_trig_init);
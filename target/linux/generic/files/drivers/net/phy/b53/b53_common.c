@@ -35,6 +35,9 @@
 /* buffer size needed for displaying all MIBs with max'd values */
 #define B53_BUF_SIZE	1188
 
+/* MIB counters fetched per bulk read */
+#define B53_MIB_BULK	16
+
 struct b53_mib_desc {
 	u8 size;
 	u8 offset;
@@ -1030,21 +1033,21 @@ static int b53_port_get_mib(struct switch_dev *sw_dev,
 
 	dev->buf[0] = 0;
 
-	for (; mibs->size > 0; mibs++) {
-		u64 val;
-
-		if (mibs->size == 8) {
-			b53_read64(dev, B53_MIB_PAGE(port), mibs->offset, &val);
-		} else {
-			u32 val32;
+	while (mibs->size > 0) {
+		struct b53_reg_val regs[B53_MIB_BULK];
+		unsigned int i, n;
 
-			b53_read32(dev, B53_MIB_PAGE(port), mibs->offset,
-				   &val32);
-			val = val32;
+		for (n = 0; n < B53_MIB_BULK && mibs[n].size > 0; n++) {
+			regs[n].reg = mibs[n].offset;
+			regs[n].size = mibs[n].size;
 		}
 
-		len += snprintf(dev->buf + len, B53_BUF_SIZE - len,
-				"%-20s: %llu\n", mibs->name, val);
+		b53_read_bulk(dev, B53_MIB_PAGE(port), regs, n);
+
+		for (i = 0; i < n; i++, mibs++)
+			len += snprintf(dev->buf + len, B53_BUF_SIZE - len,
+					"%-20s: %llu\n", mibs->name,
+					regs[i].val);
 	}
 
 	val->len = len;
@@ -1058,8 +1061,8 @@ static int b53_port_get_stats(struct switch_dev *sw_dev, int port,
 {
 	struct b53_device *dev = sw_to_b53(sw_dev);
 	const struct b53_mib_desc *mibs;
+	struct b53_reg_val regs[2];
 	int txb_id, rxb_id;
-	u64 rxb, txb;
 
 	if (!(BIT(port) & dev->enabled_ports))
 		return -EINVAL;
@@ -1082,21 +1085,15 @@ static int b53_port_get_stats(struct switch_dev *sw_dev, int port,
 
 	dev->buf[0] = 0;
 
-	if (mibs->size == 8) {
-		b53_read64(dev, B53_MIB_PAGE(port), mibs[txb_id].offset, &txb);
-		b53_read64(dev, B53_MIB_PAGE(port), mibs[rxb_id].offset, &rxb);
-	} else {
-		u32 val32;
-
-		b53_read32(dev, B53_MIB_PAGE(port), mibs[txb_id].offset, &val32);
-		txb = val32;
+	regs[0].reg = mibs[txb_id].offset;
+	regs[0].size = mibs[txb_id].size;
+	regs[1].reg = mibs[rxb_id].offset;
+	regs[1].size = mibs[rxb_id].size;
 
-		b53_read32(dev, B53_MIB_PAGE(port), mibs[rxb_id].offset, &val32);
-		rxb = val32;
-	}
+	b53_read_bulk(dev, B53_MIB_PAGE(port), regs, 2);
 
-	stats->tx_bytes = txb;
-	stats->rx_bytes = rxb;
+	stats->tx_bytes = regs[0].val;
+	stats->rx_bytes = regs[1].val;
 
 	return 0;
 }
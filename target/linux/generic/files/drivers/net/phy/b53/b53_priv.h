@@ -25,6 +25,13 @@
 
 struct b53_device;
 
+/* one register of a bulk read, size is in bytes */
+struct b53_reg_val {
+	u8 reg;
+	u8 size;
+	u64 val;
+};
+
 struct b53_io_ops {
 	int (*read8)(struct b53_device *dev, u8 page, u8 reg, u8 *value);
 	int (*read16)(struct b53_device *dev, u8 page, u8 reg, u16 *value);
@@ -38,6 +45,9 @@ struct b53_io_ops {
 	int (*write64)(struct b53_device *dev, u8 page, u8 reg, u64 value);
 	int (*phy_read16)(struct b53_device *dev, int addr, u8 reg, u16 *value);
 	int (*phy_write16)(struct b53_device *dev, int addr, u8 reg, u16 value);
+	/* optional, read several registers of one page at once */
+	int (*read_bulk)(struct b53_device *dev, u8 page,
+			 struct b53_reg_val *regs, unsigned int count);
 };
 
 enum {
@@ -250,6 +260,65 @@ static inline int b53_read64(struct b53_device *dev, u8 page, u8 reg, u64 *val)
 	return ret;
 }
 
+static inline int __b53_read_reg_val(struct b53_device *dev, u8 page,
+				     struct b53_reg_val *r)
+{
+	u32 val32;
+	u16 val16;
+	u8 val8;
+	int ret;
+
+	switch (r->size) {
+	case 1:
+		ret = dev->ops->read8(dev, page, r->reg, &val8);
+		r->val = val8;
+		break;
+	case 2:
+		ret = dev->ops->read16(dev, page, r->reg, &val16);
+		r->val = val16;
+		break;
+	case 4:
+		ret = dev->ops->read32(dev, page, r->reg, &val32);
+		r->val = val32;
+		break;
+	case 6:
+		ret = dev->ops->read48(dev, page, r->reg, &r->val);
+		break;
+	case 8:
+		ret = dev->ops->read64(dev, page, r->reg, &r->val);
+		break;
+	default:
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+/*
+ * Read count registers of a page, backends without a bulk read get one
+ * register access after the other.
+ */
+static inline int b53_read_bulk(struct b53_device *dev, u8 page,
+				struct b53_reg_val *regs, unsigned int count)
+{
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < count; i++)
+		regs[i].val = 0;
+
+	mutex_lock(&dev->reg_mutex);
+	if (dev->ops->read_bulk) {
+		ret = dev->ops->read_bulk(dev, page, regs, count);
+	} else {
+		for (i = 0; i < count && !ret; i++)
+			ret = __b53_read_reg_val(dev, page, &regs[i]);
+	}
+	mutex_unlock(&dev->reg_mutex);
+
+	return ret;
+}
+
 static inline int b53_write8(struct b53_device *dev, u8 page, u8 reg, u8 value)
 {
 	int ret;
@@ -39,103 +39,219 @@
 
 #define B53_SPI_PAGE_SELECT	0xff
 
-static inline int b53_spi_read_reg(struct spi_device *spi, u8 reg, u8 *val,
-				     unsigned len)
-{
-	u8 txbuf[2];
+/* status polling back-off, doubled on every retry */
+#define B53_SPI_POLL_MIN_US	1
+#define B53_SPI_POLL_MAX_US	256
+#define B53_SPI_TIMEOUT_US	10000
 
-	txbuf[0] = B53_SPI_CMD_NORMAL | B53_SPI_CMD_READ;
-	txbuf[1] = reg;
+/* status, page select, register read and status again */
+#define B53_SPI_MAX_XFERS	7
 
-	return spi_write_then_read(spi, txbuf, 2, val, len);
+/*
+ * All SPI buffers live here so they are DMA safe, accesses are serialized
+ * by the reg_mutex of the b53 device.
+ */
+struct b53_spi_priv {
+	struct spi_device *spi;
+
+	struct spi_message msg;
+	struct spi_transfer xfers[B53_SPI_MAX_XFERS];
+	unsigned int n_xfers;
+
+	u8 cmd_status[2] ____cacheline_aligned;
+	u8 cmd_page[3];
+	u8 cmd_reg[2];
+	u8 cmd_data[2];
+	u8 cmd_write[10];
+
+	u8 rx_spif ____cacheline_aligned;
+	u8 rx_rack;
+	u8 rx_dummy;
+	u8 rx_data[8];
+};
+
+static void b53_spi_msg_init(struct b53_spi_priv *priv)
+{
+	spi_message_init(&priv->msg);
+	memset(priv->xfers, 0, sizeof(priv->xfers));
+	priv->n_xfers = 0;
 }
 
-static inline int b53_spi_clear_status(struct spi_device *spi)
+/* queue one chip select framed command, optionally followed by a read */
+static void b53_spi_msg_add(struct b53_spi_priv *priv, const u8 *tx,
+			    unsigned int tx_len, u8 *rx, unsigned int rx_len)
 {
-	unsigned int i;
-	u8 rxbuf;
-	int ret;
+	struct spi_transfer *t = &priv->xfers[priv->n_xfers];
+
+	if (priv->n_xfers)
+		priv->xfers[priv->n_xfers - 1].cs_change = 1;
+
+	t->tx_buf = tx;
+	t->len = tx_len;
+	spi_message_add_tail(t, &priv->msg);
+	priv->n_xfers++;
+
+	if (rx) {
+		t++;
+		t->rx_buf = rx;
+		t->len = rx_len;
+		spi_message_add_tail(t, &priv->msg);
+		priv->n_xfers++;
+	}
+}
 
-	for (i = 0; i < 10; i++) {
-		ret = b53_spi_read_reg(spi, B53_SPI_STATUS, &rxbuf, 1);
-		if (ret)
-			return ret;
+/*
+ * Start a new access: sample the status register and select the page unless
+ * it is the one selected last time.
+ */
+static void b53_spi_msg_start(struct b53_device *dev, u8 page)
+{
+	struct b53_spi_priv *priv = dev->priv;
 
-		if (!(rxbuf & B53_SPI_CMD_SPIF))
-			break;
+	b53_spi_msg_init(priv);
+	b53_spi_msg_add(priv, priv->cmd_status, 2, &priv->rx_spif, 1);
 
-		mdelay(1);
+	if (dev->current_page != page) {
+		priv->cmd_page[2] = page;
+		b53_spi_msg_add(priv, priv->cmd_page, 3, NULL, 0);
 	}
+}
 
-	if (i == 10)
-		return -EIO;
+static int b53_spi_msg_sync(struct b53_device *dev, u8 page)
+{
+	struct b53_spi_priv *priv = dev->priv;
+	int ret;
+
+	ret = spi_sync(priv->spi, &priv->msg);
+	if (ret) {
+		dev->current_page = 0xff;
+		return ret;
+	}
+
+	dev->current_page = page;
 
 	return 0;
 }
 
-static inline int b53_spi_set_page(struct spi_device *spi, u8 page)
+/* poll the status register until (status & mask) == val */
+static int b53_spi_poll_status(struct b53_spi_priv *priv, u8 mask, u8 val)
 {
-	u8 txbuf[3];
+	unsigned int delay = B53_SPI_POLL_MIN_US;
+	unsigned int waited = 0;
+	int ret;
+
+	do {
+		if (delay <= 10)
+			udelay(delay);
+		else
+			usleep_range(delay, delay * 2);
 
-	txbuf[0] = B53_SPI_CMD_NORMAL | B53_SPI_CMD_WRITE;
-	txbuf[1] = B53_SPI_PAGE_SELECT;
-	txbuf[2] = page;
+		waited += delay;
+		delay = min_t(unsigned int, delay * 2, B53_SPI_POLL_MAX_US);
 
-	return spi_write(spi, txbuf, sizeof(txbuf));
+		ret = spi_write_then_read(priv->spi, priv->cmd_status, 2,
+					  &priv->rx_rack, 1);
+		if (ret)
+			return ret;
+
+		if ((priv->rx_rack & mask) == val)
+			return 0;
+	} while (waited < B53_SPI_TIMEOUT_US);
+
+	return -EIO;
 }
 
-static inline int b53_prepare_reg_access(struct spi_device *spi, u8 page)
+/*
+ * The interface was still busy with a previous access when this one was
+ * sent, wait for it and make sure the page gets written again.
+ */
+static int b53_spi_busy(struct b53_device *dev)
 {
-	int ret = b53_spi_clear_status(spi);
+	struct b53_spi_priv *priv = dev->priv;
 
-	if (ret)
-		return ret;
+	dev->current_page = 0xff;
 
-	return b53_spi_set_page(spi, page);
+	return b53_spi_poll_status(priv, B53_SPI_CMD_SPIF, 0);
 }
 
-static int b53_spi_prepare_reg_read(struct spi_device *spi, u8 reg)
+/* select the page and request a register read in one message */
+static int b53_spi_prepare_read(struct b53_device *dev, u8 page, u8 reg)
 {
-	u8 rxbuf;
-	int retry_count;
+	struct b53_spi_priv *priv = dev->priv;
+	unsigned int retry;
 	int ret;
 
-	ret = b53_spi_read_reg(spi, reg, &rxbuf, 1);
-	if (ret)
-		return ret;
+	for (retry = 0; retry < 2; retry++) {
+		b53_spi_msg_start(dev, page);
 
-	for (retry_count = 0; retry_count < 10; retry_count++) {
-		ret = b53_spi_read_reg(spi, B53_SPI_STATUS, &rxbuf, 1);
+		priv->cmd_reg[1] = reg;
+		b53_spi_msg_add(priv, priv->cmd_reg, 2, &priv->rx_dummy, 1);
+		b53_spi_msg_add(priv, priv->cmd_status, 2, &priv->rx_rack, 1);
+
+		ret = b53_spi_msg_sync(dev, page);
 		if (ret)
 			return ret;
 
-		if (rxbuf & B53_SPI_CMD_RACK)
+		if (!(priv->rx_spif & B53_SPI_CMD_SPIF))
 			break;
 
-		mdelay(1);
+		ret = b53_spi_busy(dev);
+		if (ret)
+			return ret;
 	}
 
-	if (retry_count == 10)
+	if (retry == 2)
 		return -EIO;
 
-	return 0;
+	if (priv->rx_rack & B53_SPI_CMD_RACK)
+		return 0;
+
+	return b53_spi_poll_status(priv, B53_SPI_CMD_RACK, B53_SPI_CMD_RACK);
 }
 
-static int b53_spi_read(struct b53_device *dev, u8 page, u8 reg, u8 *data,
-			unsigned len)
+/*
+ * Fetch the data of a prepared read, and if next_reg is valid, request the
+ * read of the next register of the same page in the same message.
+ */
+static int b53_spi_read_data(struct b53_device *dev, u8 *data,
+			     unsigned int len, int next_reg)
 {
-	struct spi_device *spi = dev->priv;
+	struct b53_spi_priv *priv = dev->priv;
 	int ret;
 
-	ret = b53_prepare_reg_access(spi, page);
-	if (ret)
+	b53_spi_msg_init(priv);
+	b53_spi_msg_add(priv, priv->cmd_data, 2, priv->rx_data, len);
+
+	if (next_reg >= 0) {
+		priv->cmd_reg[1] = next_reg;
+		b53_spi_msg_add(priv, priv->cmd_reg, 2, &priv->rx_dummy, 1);
+		b53_spi_msg_add(priv, priv->cmd_status, 2, &priv->rx_rack, 1);
+	}
+
+	ret = spi_sync(priv->spi, &priv->msg);
+	if (ret) {
+		dev->current_page = 0xff;
 		return ret;
+	}
+
+	memcpy(data, priv->rx_data, len);
+
+	if (next_reg < 0 || (priv->rx_rack & B53_SPI_CMD_RACK))
+		return 0;
+
+	return b53_spi_poll_status(priv, B53_SPI_CMD_RACK, B53_SPI_CMD_RACK);
+}
 
-	ret = b53_spi_prepare_reg_read(spi, reg);
+static int b53_spi_read(struct b53_device *dev, u8 page, u8 reg, u8 *data,
+			unsigned len)
+{
+	int ret;
+
+	ret = b53_spi_prepare_read(dev, page, reg);
 	if (ret)
 		return ret;
 
-	return b53_spi_read_reg(spi, B53_SPI_DATA, data, len);
+	return b53_spi_read_data(dev, data, len, -1);
 }
 
 static int b53_spi_read8(struct b53_device *dev, u8 page, u8 reg, u8 *val)
@@ -185,89 +301,105 @@ static int b53_spi_read64(struct b53_device *dev, u8 page, u8 reg, u64 *val)
 	return ret;
 }
 
-static int b53_spi_write8(struct b53_device *dev, u8 page, u8 reg, u8 value)
+/*
+ * Read several registers of one page, the data of each register is fetched
+ * in the same message that requests the next one.
+ */
+static int b53_spi_read_bulk(struct b53_device *dev, u8 page,
+			     struct b53_reg_val *regs, unsigned int count)
 {
-	struct spi_device *spi = dev->priv;
+	unsigned int i;
 	int ret;
-	u8 txbuf[3];
 
-	ret = b53_prepare_reg_access(spi, page);
+	if (!count)
+		return 0;
+
+	ret = b53_spi_prepare_read(dev, page, regs[0].reg);
 	if (ret)
 		return ret;
 
-	txbuf[0] = B53_SPI_CMD_NORMAL | B53_SPI_CMD_WRITE;
-	txbuf[1] = reg;
-	txbuf[2] = value;
+	for (i = 0; i < count; i++) {
+		u8 buf[8] = { 0 };
+
+		ret = b53_spi_read_data(dev, buf, regs[i].size,
+					i + 1 < count ? regs[i + 1].reg : -1);
+		if (ret)
+			return ret;
+
+		regs[i].val = get_unaligned_le64(buf);
+	}
 
-	return spi_write(spi, txbuf, sizeof(txbuf));
+	return 0;
 }
 
-static int b53_spi_write16(struct b53_device *dev, u8 page, u8 reg, u16 value)
+static int b53_spi_write(struct b53_device *dev, u8 page, u8 reg,
+			 const u8 *data, unsigned int len)
 {
-	struct spi_device *spi = dev->priv;
+	struct b53_spi_priv *priv = dev->priv;
+	unsigned int retry;
 	int ret;
-	u8 txbuf[4];
 
-	ret = b53_prepare_reg_access(spi, page);
-	if (ret)
-		return ret;
+	priv->cmd_write[1] = reg;
+	memcpy(&priv->cmd_write[2], data, len);
+
+	for (retry = 0; retry < 2; retry++) {
+		b53_spi_msg_start(dev, page);
+		b53_spi_msg_add(priv, priv->cmd_write, len + 2, NULL, 0);
 
-	txbuf[0] = B53_SPI_CMD_NORMAL | B53_SPI_CMD_WRITE;
-	txbuf[1] = reg;
-	put_unaligned_le16(value, &txbuf[2]);
+		ret = b53_spi_msg_sync(dev, page);
+		if (ret)
+			return ret;
+
+		if (!(priv->rx_spif & B53_SPI_CMD_SPIF))
+			return 0;
+
+		ret = b53_spi_busy(dev);
+		if (ret)
+			return ret;
+	}
 
-	return spi_write(spi, txbuf, sizeof(txbuf));
+	return -EIO;
 }
 
-static int b53_spi_write32(struct b53_device *dev, u8 page, u8 reg, u32 value)
+static int b53_spi_write8(struct b53_device *dev, u8 page, u8 reg, u8 value)
 {
-	struct spi_device *spi = dev->priv;
-	int ret;
-	u8 txbuf[6];
+	return b53_spi_write(dev, page, reg, &value, 1);
+}
 
-	ret = b53_prepare_reg_access(spi, page);
-	if (ret)
-		return ret;
+static int b53_spi_write16(struct b53_device *dev, u8 page, u8 reg, u16 value)
+{
+	u8 txbuf[2];
 
-	txbuf[0] = B53_SPI_CMD_NORMAL | B53_SPI_CMD_WRITE;
-	txbuf[1] = reg;
-	put_unaligned_le32(value, &txbuf[2]);
+	put_unaligned_le16(value, txbuf);
 
-	return spi_write(spi, txbuf, sizeof(txbuf));
+	return b53_spi_write(dev, page, reg, txbuf, sizeof(txbuf));
 }
 
-static int b53_spi_write48(struct b53_device *dev, u8 page, u8 reg, u64 value)
+static int b53_spi_write32(struct b53_device *dev, u8 page, u8 reg, u32 value)
 {
-	struct spi_device *spi = dev->priv;
-	int ret;
-	u8 txbuf[10];
+	u8 txbuf[4];
 
-	ret = b53_prepare_reg_access(spi, page);
-	if (ret)
-		return ret;
+	put_unaligned_le32(value, txbuf);
 
-	txbuf[0] = B53_SPI_CMD_NORMAL | B53_SPI_CMD_WRITE;
-	txbuf[1] = reg;
-	put_unaligned_le64(value, &txbuf[2]);
+	return b53_spi_write(dev, page, reg, txbuf, sizeof(txbuf));
+}
 
-	return spi_write(spi, txbuf, sizeof(txbuf) - 2);
+static int b53_spi_write48(struct b53_device *dev, u8 page, u8 reg, u64 value)
+{
+	u8 txbuf[8];
+
+	put_unaligned_le64(value, txbuf);
+
+	return b53_spi_write(dev, page, reg, txbuf, 6);
 }
 
 static int b53_spi_write64(struct b53_device *dev, u8 page, u8 reg, u64 value)
 {
-	struct spi_device *spi = dev->priv;
-	int ret;
-	u8 txbuf[10];
+	u8 txbuf[8];
 
-	ret = b53_prepare_reg_access(spi, page);
-	if (ret)
-		return ret;
-
-	txbuf[0] = B53_SPI_CMD_NORMAL | B53_SPI_CMD_WRITE;
-	txbuf[1] = reg;
-	put_unaligned_le64(value, &txbuf[2]);
+	put_unaligned_le64(value, txbuf);
 
-	return spi_write(spi, txbuf, sizeof(txbuf));
+	return b53_spi_write(dev, page, reg, txbuf, sizeof(txbuf));
 }
 
 static struct b53_io_ops b53_spi_ops = {
@@ -281,17 +413,36 @@ static struct b53_io_ops b53_spi_ops = {
 	.write32 = b53_spi_write32,
 	.write48 = b53_spi_write48,
 	.write64 = b53_spi_write64,
+	.read_bulk = b53_spi_read_bulk,
 };
 
 static int b53_spi_probe(struct spi_device *spi)
 {
+	struct b53_spi_priv *priv;
 	struct b53_device *dev;
 	int ret;
 
-	dev = b53_switch_alloc(&spi->dev, &b53_spi_ops, spi);
+	priv = devm_kzalloc(&spi->dev, sizeof(*priv), GFP_KERNEL);
+	if (!priv)
+		return -ENOMEM;
+
+	priv->spi = spi;
+	priv->cmd_status[0] = B53_SPI_CMD_NORMAL | B53_SPI_CMD_READ;
+	priv->cmd_status[1] = B53_SPI_STATUS;
+	priv->cmd_page[0] = B53_SPI_CMD_NORMAL | B53_SPI_CMD_WRITE;
+	priv->cmd_page[1] = B53_SPI_PAGE_SELECT;
+	priv->cmd_reg[0] = B53_SPI_CMD_NORMAL | B53_SPI_CMD_READ;
+	priv->cmd_data[0] = B53_SPI_CMD_NORMAL | B53_SPI_CMD_READ;
+	priv->cmd_data[1] = B53_SPI_DATA;
+	priv->cmd_write[0] = B53_SPI_CMD_NORMAL | B53_SPI_CMD_WRITE;
+
+	dev = b53_switch_alloc(&spi->dev, &b53_spi_ops, priv);
 	if (!dev)
 		return -ENOMEM;
 
+	/* force a page select on the first access */
+	dev->current_page = 0xff;
+
 	if (spi->dev.platform_data)
 		dev->pdata = spi->dev.platform_data;
 
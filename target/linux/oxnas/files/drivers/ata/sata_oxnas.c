@@ -28,6 +28,8 @@
 #include <linux/of_irq.h>
 #include <linux/clk.h>
 #include <linux/reset.h>
+#include <linux/workqueue.h>
+#include <scsi/scsi_host.h>
 
 #include <mach/utils.h>
 
@@ -335,6 +337,15 @@ enum {
 	SATA_SCSI_STACK
 };
 
+/*
+ * With the JBOD micro-code each port has its own SGDMA channel, data mux RAM
+ * and end-of-command interrupt, so the SCSI stack may hold the core for both
+ * ports at once. Set to 0 to go back to one port at a time.
+ */
+static bool overlap_ports = true;
+module_param(overlap_ports, bool, 0644);
+MODULE_PARM_DESC(overlap_ports, "Allow commands on both ports at the same time (default: true)");
+
 typedef irqreturn_t (*oxnas_sata_isr_callback_t)(int, unsigned long, int);
 
 struct sata_oxnas_host_priv {
@@ -343,6 +354,7 @@ struct sata_oxnas_host_priv {
 	void __iomem *sgdma_base;
 	void __iomem *core_base;
 	void __iomem *phy_base;
+	struct ata_host *host;
 	dma_addr_t dma_base;
 	void __iomem *dma_base_va;
 	size_t dma_size;
@@ -358,8 +370,10 @@ struct sata_oxnas_host_priv {
 	spinlock_t phy_lock;
 	spinlock_t core_lock;
 	int core_locked;
-	int reentrant_port_no;
-	int hw_lock_count;
+	u32 locked_ports;
+	int hw_lock_count[SATA_OXNAS_MAX_PORTS];
+	u32 refused_ports;
+	struct work_struct kick_work;
 	int direct_lock_count;
 	void *locker_uid;
 	int current_locker_type;
@@ -382,6 +396,7 @@ struct sata_oxnas_port_priv {
 
 static u8 sata_oxnas_check_status(struct ata_port *ap);
 static int sata_oxnas_cleanup(struct ata_host *ah);
+static int sata_oxnas_sibling_active(struct ata_port *ap);
 static void sata_oxnas_tf_load(struct ata_port *ap,
 				const struct ata_taskfile *tf);
 static void sata_oxnas_irq_on(struct ata_port *ap);
@@ -562,6 +577,7 @@ static unsigned int sata_oxnas_qc_issue(struct ata_queued_cmd *qc)
 	void __iomem *core_base = pd->core_base;
 	int port_no = qc->ap->port_no;
 	int no_microcode = (hd->current_ucode == UNKNOWN_MODE);
+	unsigned long flags;
 	u32 reg;
 
 	/* check the core is idle */
@@ -575,6 +591,10 @@ static unsigned int sata_oxnas_qc_issue(struct ata_queued_cmd *qc)
 			if (++count > 100) {
 				DPRINTK("core busy for a command on port %d\n",
 					qc->ap->port_no);
+				/* the reset would kill the command of the other
+				 * port, let EH drain that port first */
+				if (sata_oxnas_sibling_active(qc->ap))
+					return AC_ERR_SYSTEM;
 				/* CrazyDumpDebug(); */
 				sata_oxnas_cleanup(qc->ap->host);
 			}
@@ -582,18 +602,22 @@ static unsigned int sata_oxnas_qc_issue(struct ata_queued_cmd *qc)
 	}
 
 	/* enable passing of error signals to DMA sub-core by clearing the
-	 * appropriate bit */
+	 * appropriate bit, the other port may be issuing at the same time */
+	spin_lock_irqsave(&hd->core_lock, flags);
 	reg = ioread32(core_base + DATA_PLANE_CTRL);
 	if (no_microcode)
 		reg |= (DPC_ERROR_MASK_BIT | (DPC_ERROR_MASK_BIT << 1));
 	reg &= ~(DPC_ERROR_MASK_BIT << port_no);
 	iowrite32(reg, core_base + DATA_PLANE_CTRL);
+	spin_unlock_irqrestore(&hd->core_lock, flags);
 
 	/* Disable all interrupts for ports and RAID controller */
 	iowrite32(~0, port_base + INT_DISABLE);
 
-	/* Disable all interrupts for core */
-	iowrite32(~0, core_base + CORE_INT_DISABLE);
+	/* Disable the core interrupts of this port only, the other port
+	 * may have a command in flight */
+	iowrite32((COREINT_HOST | COREINT_END) << port_no,
+		  core_base + CORE_INT_DISABLE);
 	wmb();
 
 	/* Load the command settings into the orb registers */
@@ -608,7 +632,7 @@ static unsigned int sata_oxnas_qc_issue(struct ata_queued_cmd *qc)
 
 	/* enable End of command interrupt */
 	iowrite32(INT_WANT, port_base + INT_ENABLE);
-	iowrite32(COREINT_END, core_base + CORE_INT_ENABLE);
+	iowrite32(COREINT_END << port_no, core_base + CORE_INT_ENABLE);
 	wmb();
 
 	/* Start the command */
@@ -637,6 +661,35 @@ void sata_oxnas_checkforhotplug(struct ata_port *ap)
 /**************************************************************************/
 /* Locking                                                                */
 /**************************************************************************/
+/**
+ * Both ports may hold the core for the SCSI stack at the same time only with
+ * the JBOD micro-code, in the RAID modes the ports share one data path. No
+ * port joins while another one is in EH, which may reset the whole core.
+ */
+static inline int sata_oxnas_may_overlap(struct sata_oxnas_host_priv *hd)
+{
+	smp_rmb();
+	return overlap_ports && hd->current_ucode == OXNASSATA_NOTRAID &&
+	       !hd->port_in_eh;
+}
+
+/**
+ * Whether a port other than this one holds the core for the SCSI stack, a
+ * core reset would then also hit the command it has in flight
+ */
+static int sata_oxnas_sibling_active(struct ata_port *ap)
+{
+	struct sata_oxnas_host_priv *hd = ap->host->private_data;
+	unsigned long flags;
+	int active;
+
+	spin_lock_irqsave(&hd->core_lock, flags);
+	active = !!(hd->locked_ports & ~BIT(ap->port_no));
+	spin_unlock_irqrestore(&hd->core_lock, flags);
+
+	return active;
+}
+
 /**
  * The underlying function that controls access to the sata core
  *
@@ -671,26 +724,38 @@ static int __acquire_sata_core(
 
 	DPRINTK("Entered uid %p, port %d, h/w count %d, d count %d, "
 		    "callback %p, hw_access %d, core_locked %d, "
-		    "reentrant_port_no %d, isr_callback %p\n",
-		uid, port_no, hd->hw_lock_count, hd->direct_lock_count,
-		callback, hw_access, hd->core_locked, hd->reentrant_port_no,
-		hd->isr_callback);
+		    "locked_ports %x, isr_callback %p\n",
+		uid, port_no, hd->hw_lock_count[port_no],
+		hd->direct_lock_count, callback, hw_access, hd->core_locked,
+		hd->locked_ports, hd->isr_callback);
 
 	while (!timed_out) {
 		if (hd->core_locked ||
 		    (!hw_access && hd->scsi_nonblocking_attempts)) {
 			/* Can only allow access if from SCSI/SATA stack and if
 			 * reentrant access is allowed and this access is to the
-			 * same port for which the lock is current held
+			 * same port for which the lock is current held, or
+			 * the ports may overlap
 			 */
-			if (hw_access && (port_no == hd->reentrant_port_no)) {
-				BUG_ON(!hd->hw_lock_count);
-				++(hd->hw_lock_count);
+			if (hw_access &&
+			    (hd->locked_ports & BIT(port_no))) {
+				BUG_ON(!hd->hw_lock_count[port_no]);
+				++(hd->hw_lock_count[port_no]);
 
 				DPRINTK("Allow SCSI/SATA re-entrant access to "
 					"uid %p port %d\n", uid, port_no);
 				acquired = 1;
 				break;
+			} else if (hw_access &&
+				   hd->current_locker_type == SATA_SCSI_STACK &&
+				   sata_oxnas_may_overlap(hd)) {
+				hd->locked_ports |= BIT(port_no);
+				++(hd->hw_lock_count[port_no]);
+
+				DPRINTK("Allow SCSI/SATA overlapped access to "
+					"uid %p port %d\n", uid, port_no);
+				acquired = 1;
+				break;
 			} else if (!hw_access) {
 				if ((locker_type == SATA_READER) &&
 				    (hd->current_locker_type == SATA_READER)) {
@@ -700,7 +765,7 @@ static int __acquire_sata_core(
 						"port %d, h/w count %d, "
 						"d count %d, hw_access %d\n",
 						uid, hd->locker_uid, port_no,
-						hd->hw_lock_count,
+						hd->hw_lock_count[port_no],
 						hd->direct_lock_count,
 						hw_access);
 					goto check_uid;
@@ -720,15 +785,15 @@ check_uid:
 					"hw_access %d\n", locker_type, uid,
 					hd->current_locker_type,
 					hd->locker_uid, port_no,
-					hd->hw_lock_count,
+					hd->hw_lock_count[port_no],
 					hd->direct_lock_count, hw_access);
 			}
 		} else {
-			WARN(hd->hw_lock_count || hd->direct_lock_count,
+			WARN(hd->locked_ports || hd->direct_lock_count,
 				"Core unlocked but counts non-zero: uid %p, "
-				"locker_uid %p, port %d, h/w count %d, "
+				"locker_uid %p, port %d, ports %x, "
 				"d count %d, hw_access %d\n", uid,
-				hd->locker_uid, port_no, hd->hw_lock_count,
+				hd->locker_uid, port_no, hd->locked_ports,
 				hd->direct_lock_count, hw_access);
 
 			BUG_ON(hd->current_locker_type != SATA_UNLOCKED);
@@ -736,7 +801,8 @@ check_uid:
 			WARN(hd->locker_uid, "Attempt to lock uid %p when "
 				"locker_uid %p is non-zero,  port %d, "
 				"h/w count %d, d count %d, hw_access %d\n",
-				uid, hd->locker_uid, port_no, hd->hw_lock_count,
+				uid, hd->locker_uid, port_no,
+				hd->hw_lock_count[port_no],
 				hd->direct_lock_count, hw_access);
 
 			if (!hw_access) {
@@ -746,7 +812,7 @@ check_uid:
 				/* Must have callback for direct access */
 				BUG_ON(!callback);
 				/* Sanity check lock state */
-				BUG_ON(hd->reentrant_port_no != -1);
+				BUG_ON(hd->locked_ports);
 
 				hd->isr_callback = callback;
 				hd->isr_arg = arg;
@@ -766,8 +832,8 @@ check_uid:
 				BUG_ON(hd->isr_callback);
 				BUG_ON(hd->isr_arg);
 
-				++(hd->hw_lock_count);
-				hd->reentrant_port_no = port_no;
+				++(hd->hw_lock_count[port_no]);
+				hd->locked_ports = BIT(port_no);
 
 				hd->current_locker_type = SATA_SCSI_STACK;
 			}
@@ -785,8 +851,10 @@ wait_for_lock:
 			"cannot sleep\n", uid, locker_type, hw_access, port_no,
 			hd->current_locker_type);
 
-			if (hw_access)
+			if (hw_access) {
 				++(hd->scsi_nonblocking_attempts);
+				hd->refused_ports |= BIT(port_no);
+			}
 
 			break;
 		}
@@ -813,13 +881,13 @@ wait_for_lock:
 					"uid %p failing for port %d timed out, "
 					"locker_uid %p, h/w count %d, "
 					"d count %d, callback %p, hw_access %d, "
-					"core_locked %d, reentrant_port_no %d, "
+					"core_locked %d, locked_ports %x, "
 					"isr_callback %p, isr_arg %p\n", uid,
 					port_no, hd->locker_uid,
-					hd->hw_lock_count,
+					hd->hw_lock_count[port_no],
 					hd->direct_lock_count, callback,
 					hw_access, hd->core_locked,
-					hd->reentrant_port_no, hd->isr_callback,
+					hd->locked_ports, hd->isr_callback,
 					hd->isr_arg);
 				timed_out = 1;
 				break;
@@ -912,43 +980,45 @@ static void sata_oxnas_release_hw(struct ata_port *ap)
 {
 	unsigned long flags;
 	int released = 0;
+	int port_no = ap->port_no;
 	struct sata_oxnas_host_priv *hd = ap->host->private_data;
 
 	spin_lock_irqsave(&hd->core_lock, flags);
 
 	DPRINTK("Entered port_no = %d, h/w count %d, d count %d, "
-		"core locked = %d, reentrant_port_no = %d, isr_callback %p\n",
-		ap->port_no, hd->hw_lock_count, hd->direct_lock_count,
-		hd->core_locked, hd->reentrant_port_no, hd->isr_callback);
+		"core locked = %d, locked_ports = %x, isr_callback %p\n",
+		port_no, hd->hw_lock_count[port_no], hd->direct_lock_count,
+		hd->core_locked, hd->locked_ports, hd->isr_callback);
 
 	if (!hd->core_locked) {
 		/* Nobody holds the SATA lock */
 		printk(KERN_WARNING "Nobody holds SATA lock, port_no %d\n",
-		       ap->port_no);
+		       port_no);
 		released = 1;
-	} else if (!hd->hw_lock_count) {
+	} else if (!hd->hw_lock_count[port_no]) {
 		/* SCSI/SATA has released without holding the lock */
 		printk(KERN_WARNING "SCSI/SATA does not hold SATA lock, "
-		       "port_no %d\n", ap->port_no);
+		       "port_no %d\n", port_no);
 	} else {
 		/* Trap incorrect usage */
-		BUG_ON(hd->reentrant_port_no == -1);
-		BUG_ON(ap->port_no != hd->reentrant_port_no);
+		BUG_ON(!(hd->locked_ports & BIT(port_no)));
 		BUG_ON(hd->direct_lock_count);
 		BUG_ON(hd->current_locker_type != SATA_SCSI_STACK);
 
 		WARN(!hd->locker_uid || (hd->locker_uid != HW_LOCKER_UID),
 			"Invalid locker uid %p, h/w count %d, d count %d, "
-			"reentrant_port_no %d, core_locked %d, "
-			"isr_callback %p\n", hd->locker_uid, hd->hw_lock_count,
-			hd->direct_lock_count, hd->reentrant_port_no,
-			hd->core_locked, hd->isr_callback);
-
-		if (--(hd->hw_lock_count)) {
-			DPRINTK("Still nested port_no %d\n", ap->port_no);
+			"locked_ports %x, core_locked %d, "
+			"isr_callback %p\n", hd->locker_uid,
+			hd->hw_lock_count[port_no], hd->direct_lock_count,
+			hd->locked_ports, hd->core_locked, hd->isr_callback);
+
+		if (--(hd->hw_lock_count[port_no])) {
+			DPRINTK("Still nested port_no %d\n", port_no);
+		} else if (hd->locked_ports &= ~BIT(port_no)) {
+			DPRINTK("Release port_no %d, other port still "
+				"active\n", port_no);
 		} else {
-			DPRINTK("Release port_no %d\n", ap->port_no);
-			hd->reentrant_port_no = -1;
+			DPRINTK("Release port_no %d\n", port_no);
 			hd->isr_callback = NULL;
 			hd->current_locker_type = SATA_UNLOCKED;
 			hd->locker_uid = 0;
@@ -960,8 +1030,14 @@ static void sata_oxnas_release_hw(struct ata_port *ap)
 		}
 	}
 
-	DPRINTK("Leaving, port_no %d, count %d\n", ap->port_no,
-		hd->hw_lock_count);
+	/* A port turned away in qc_new() would otherwise sit out the SCSI
+	 * requeue delay, restart its queue as soon as it may get the core */
+	if (hd->refused_ports & ~hd->locked_ports &&
+	    (released || sata_oxnas_may_overlap(hd)))
+		schedule_work(&hd->kick_work);
+
+	DPRINTK("Leaving, port_no %d, count %d\n", port_no,
+		hd->hw_lock_count[port_no]);
 
 	spin_unlock_irqrestore(&hd->core_lock, flags);
 
@@ -971,6 +1047,28 @@ static void sata_oxnas_release_hw(struct ata_port *ap)
 	} */
 }
 
+/*
+ * restart the SCSI queues of ports refused in qc_new()
+ */
+static void sata_oxnas_kick_ports(struct work_struct *work)
+{
+	struct sata_oxnas_host_priv *hd =
+		container_of(work, struct sata_oxnas_host_priv, kick_work);
+	struct ata_host *ah = hd->host;
+	unsigned long flags;
+	u32 ports;
+	int n;
+
+	spin_lock_irqsave(&hd->core_lock, flags);
+	ports = hd->refused_ports;
+	hd->refused_ports = 0;
+	spin_unlock_irqrestore(&hd->core_lock, flags);
+
+	for (n = 0; n < hd->n_ports; n++)
+		if ((ports & BIT(n)) && ah->ports[n]->scsi_host)
+			scsi_run_host_queues(ah->ports[n]->scsi_host);
+}
+
 static inline int sata_oxnas_is_host_frozen(struct ata_host *ah)
 {
 	struct sata_oxnas_host_priv *hd = ah->private_data;
@@ -1588,12 +1686,57 @@ void sata_oxnas_thaw_host(struct ata_port *ap)
 	smp_wmb();
 }
 
+#define SATA_OXNAS_DRAIN_TIMEOUT_JIFFIES (10 * HZ)
+/**
+ * Called from EH before the core is reset. The reset hits both ports, so
+ * wait for the commands the other port has in flight to finish. New ones
+ * are refused in qc_new() while a port is in EH. Commands that do not
+ * finish in time are failed through the EH of their port, so that they
+ * are retried instead of being lost in the reset.
+ *
+ * @param ap port about to reset the core
+ */
+static void sata_oxnas_drain_sibling(struct ata_port *ap)
+{
+	struct sata_oxnas_host_priv *hd = ap->host->private_data;
+	unsigned long deadline = jiffies + SATA_OXNAS_DRAIN_TIMEOUT_JIFFIES;
+	unsigned long flags;
+	struct ata_port *sibling;
+	int n;
+
+	for (n = 0; n < hd->n_ports; n++) {
+		sibling = ap->host->ports[n];
+		if (sibling == ap)
+			continue;
+
+		while (sata_oxnas_sibling_active(ap)) {
+			smp_rmb();
+			/* its commands already belong to its own EH */
+			if (hd->port_in_eh & BIT(n))
+				break;
+
+			if (time_after(jiffies, deadline)) {
+				printk(KERN_WARNING "sata_oxnas: port %d did not "
+				       "drain, aborting its commands\n", n);
+				spin_lock_irqsave(sibling->lock, flags);
+				ata_port_abort(sibling);
+				spin_unlock_irqrestore(sibling->lock, flags);
+				break;
+			}
+
+			msleep(1);
+		}
+	}
+}
+
 static void sata_oxnas_post_internal_cmd(struct ata_queued_cmd *qc)
 {
 	DPRINTK("ENTER\n");
 	/* If the core is busy here, make it idle */
-	if (qc->flags & ATA_QCFLAG_FAILED)
+	if (qc->flags & ATA_QCFLAG_FAILED) {
+		sata_oxnas_drain_sibling(qc->ap);
 		sata_oxnas_cleanup(qc->ap->host);
+	}
 }
 
 
@@ -1944,6 +2087,7 @@ static void sata_oxnas_error_handler(struct ata_port *ap)
 	sata_oxnas_freeze_host(ap);
 
 	/* If the core is busy here, make it idle */
+	sata_oxnas_drain_sibling(ap);
 	sata_oxnas_cleanup(ap->host);
 
 	ata_std_error_handler(ap);
@@ -2355,8 +2499,11 @@ static int sata_oxnas_probe(struct platform_device *ofdev)
 	spin_lock_init(&host_priv->phy_lock);
 	spin_lock_init(&host_priv->core_lock);
 	host_priv->core_locked = 0;
-	host_priv->reentrant_port_no = -1;
-	host_priv->hw_lock_count = 0;
+	host_priv->locked_ports = 0;
+	memset(host_priv->hw_lock_count, 0, sizeof(host_priv->hw_lock_count));
+	host_priv->refused_ports = 0;
+	host_priv->host = host;
+	INIT_WORK(&host_priv->kick_work, sata_oxnas_kick_ports);
 	host_priv->direct_lock_count = 0;
 	host_priv->locker_uid = 0;
 	host_priv->current_locker_type = SATA_UNLOCKED;
@@ -2403,6 +2550,7 @@ static int sata_oxnas_remove(struct platform_device *ofdev)
 	struct sata_oxnas_host_priv *host_priv = host->private_data;
 
 	ata_host_detach(host);
+	cancel_work_sync(&host_priv->kick_work);
 
 	irq_dispose_mapping(host_priv->irq);
 	iounmap(host_priv->port_base);
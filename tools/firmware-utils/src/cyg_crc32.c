@@ -124,15 +124,50 @@ static const cyg_uint32 crc32_tab[] = {
       0x2d02ef8dL
    };
 
+/* Tables for the slice-by-8 variant: crc32_slice[k][n] is the CRC of byte
+   n followed by k zero bytes, crc32_slice[0] being crc32_tab itself. */
+static cyg_uint32 crc32_slice[8][256];
+
+static void
+crc32_slice_init(void)
+{
+  int i, k;
+
+  for (i = 0;  i < 256;  i++) {
+    crc32_slice[0][i] = crc32_tab[i];
+    for (k = 1;  k < 8;  k++)
+      crc32_slice[k][i] = crc32_tab[crc32_slice[k - 1][i] & 0xff] ^
+                          (crc32_slice[k - 1][i] >> 8);
+  }
+}
+
 /* This is the standard Gary S. Brown's 32 bit CRC algorithm, but
-   accumulate the CRC into the result of a previous CRC. */
+   accumulate the CRC into the result of a previous CRC. Eight bytes
+   are folded in per step, the loads are done bytewise so this works
+   independent of host endianness and buffer alignment. */
 cyg_uint32 
 cyg_crc32_accumulate(cyg_uint32 crc32val, unsigned char *s, int len)
 {
-  int i;
+  cyg_uint32 one, two;
 
-  for (i = 0;  i < len;  i++) {
-    crc32val = crc32_tab[(crc32val ^ s[i]) & 0xff] ^ (crc32val >> 8);
+  if (!crc32_slice[1][1])
+    crc32_slice_init();
+
+  for (;  len >= 8;  len -= 8, s += 8) {
+    one = crc32val ^ (s[0] | (s[1] << 8) | (s[2] << 16) | ((cyg_uint32)s[3] << 24));
+    two = s[4] | (s[5] << 8) | (s[6] << 16) | ((cyg_uint32)s[7] << 24);
+    crc32val = crc32_slice[7][one & 0xff] ^
+               crc32_slice[6][(one >> 8) & 0xff] ^
+               crc32_slice[5][(one >> 16) & 0xff] ^
+               crc32_slice[4][one >> 24] ^
+               crc32_slice[3][two & 0xff] ^
+               crc32_slice[2][(two >> 8) & 0xff] ^
+               crc32_slice[1][(two >> 16) & 0xff] ^
+               crc32_slice[0][two >> 24];
+  }
+
+  for (;  len > 0;  len--, s++) {
+    crc32val = crc32_tab[(crc32val ^ *s) & 0xff] ^ (crc32val >> 8);
   }
   return crc32val;
 }
@@ -150,14 +185,9 @@ cyg_crc32(unsigned char *s, int len)
 cyg_uint32
 cyg_ether_crc32_accumulate(cyg_uint32 crc32val, unsigned char *s, int len)
 {
-  int i;
-
   if (s == 0) return 0L;
   
-  crc32val = crc32val ^ 0xffffffff;
-  for (i = 0;  i < len;  i++) {
-      crc32val = crc32_tab[(crc32val ^ s[i]) & 0xff] ^ (crc32val >> 8);
-  }
+  crc32val = cyg_crc32_accumulate(crc32val ^ 0xffffffff, s, len);
   return crc32val ^ 0xffffffff;
 }
 